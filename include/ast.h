@@ -36,9 +36,36 @@ typedef enum {
     OP_BOR_ASSIGN,  // |=
     OP_BXOR_ASSIGN, // ^=
     OP_LSHIFT_ASSIGN, // <<=
-    OP_RSHIFT_ASSIGN  // >>=
+    OP_RSHIFT_ASSIGN, // >>=
+    OP_IN,            // in
+    OP_TO_FLOAT       // 隐式 int -> float 转换, 由类型检查插入
 } operator_type_t;
 
+// 类型特化后的操作码, 由类型检查阶段填写, 求值时无需再按类型分派
+typedef enum {
+    OPC_NONE,
+    // int
+    OPC_INT_ADD, OPC_INT_SUB, OPC_INT_MUL, OPC_INT_DIV, OPC_INT_MOD,
+    OPC_INT_BAND, OPC_INT_BOR, OPC_INT_BXOR, OPC_INT_LSHIFT, OPC_INT_RSHIFT,
+    OPC_INT_EQ, OPC_INT_NE, OPC_INT_GT, OPC_INT_LT, OPC_INT_GE, OPC_INT_LE,
+    OPC_INT_NEG, OPC_INT_NOT, OPC_INT_INC, OPC_INT_DEC, OPC_INT_TO_FLOAT,
+    // float
+    OPC_FLOAT_ADD, OPC_FLOAT_SUB, OPC_FLOAT_MUL, OPC_FLOAT_DIV,
+    OPC_FLOAT_EQ, OPC_FLOAT_NE, OPC_FLOAT_GT, OPC_FLOAT_LT, OPC_FLOAT_GE, OPC_FLOAT_LE,
+    OPC_FLOAT_NEG, OPC_FLOAT_INC, OPC_FLOAT_DEC,
+    // string
+    OPC_STR_CONCAT,
+    OPC_STR_EQ, OPC_STR_NE, OPC_STR_GT, OPC_STR_LT, OPC_STR_GE, OPC_STR_LE,
+    // nil 比较, 只判断是否为 nil
+    OPC_NIL_EQ, OPC_NIL_NE,
+    // 逻辑运算, 操作数均为 int
+    OPC_AND, OPC_OR,
+    // 成员测试: 编译期常量集合 / 运行时数组 / map 的键
+    OPC_IN_SET, OPC_IN_ARRAY, OPC_IN_MAP,
+    // 下标取值: map 按键 / 数组按 int 序号
+    OPC_INDEX_MAP, OPC_INDEX_ARRAY
+} opcode_t;
+
 // 返回类型枚举
 typedef enum {
     RETURN_CONTINUE,
@@ -77,11 +104,15 @@ typedef struct ast_list ast_list_t;
 typedef struct scope scope_t;
 typedef struct symbol_entry symbol_entry_t;
 typedef struct parser_context parser_context_t;
+typedef struct type type_t;
+typedef struct value_set value_set_t;
 
 // 符号表条目
 struct symbol_entry {
     char* name;
     char* type;
+    const type_t* value_type;   // 类型检查推断出的类型
+    int slot;                   // 局部变量槽位
     scope_t* scope;
     symbol_entry_t* next;
 };
@@ -103,6 +134,8 @@ struct ast_list {
 // AST 节点结构
 struct ast_node {
     ast_node_type_t type;
+    int line;
+    const type_t* value_type;   // 表达式类型, 由类型检查填写
     union {
         struct {
             ast_node_t* global;
@@ -124,6 +157,7 @@ struct ast_node {
             ast_list_t* body;
             ast_list_t* after_rules;
             ast_list_t* before_rules;
+            int slot_count;     // 局部变量槽位数
         } rule;
         
         struct {
@@ -134,6 +168,7 @@ struct ast_node {
         struct {
             char* name;
             ast_node_t* init;
+            int slot;
         } let_stmt;
         
         struct {
@@ -146,6 +181,7 @@ struct ast_node {
             char* iterator;
             ast_node_t* range;
             ast_list_t* body;
+            int slot;
         } for_stmt;
         
         struct {
@@ -165,35 +201,43 @@ struct ast_node {
         struct {
             char* name;
             ast_list_t* args;
+            int builtin;        // builtin_id_t
         } func_call;
         
         struct {
             ast_node_t* target;
             ast_node_t* key;
+            opcode_t opcode;    // 类型检查后确定的取值方式
         } map_access;
         
         struct {
             ast_node_t* target;
             char* member;
+            int field;          // 结构体成员序号
         } member_access;
         
         struct {
             operator_type_t op;
+            opcode_t opcode;
             ast_node_t* left;
             ast_node_t* right;
+            const value_set_t* set;     // in 右侧为常量数组时编译出的集合
         } binary_expr;
 
         struct {
             operator_type_t op;
+            opcode_t opcode;
             ast_node_t* operand;
         } unary_expr;
         
         struct {
             char* name;
+            int slot;           // 局部变量槽位, -1 表示全局结构体
         } identifier;
         
         struct {
-            char* value;
+            char* value;        // 已去掉引号并解码转义
+            size_t length;      // 解码后的长度, 可包含 \0
         } string_literal;
         
         struct {
@@ -0,0 +1,13 @@
+#ifndef CHECKER_H
+#define CHECKER_H
+
+#include "ast.h"
+
+// 类型检查与推断: 推断 let 变量类型, 为表达式标注类型和特化操作码,
+// 为局部变量分配槽位. 返回发现的类型错误数, 错误同时累加到 ctx->error_count
+int check_program(parser_context_t* ctx);
+
+// 把元素全为字面量的数组编译为常量集合, 字符串引用 array 中的字面量
+const value_set_t* compile_const_set(memory_pool_t* pool, const ast_node_t* array);
+
+#endif // CHECKER_H
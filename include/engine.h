@@ -0,0 +1,112 @@
+#ifndef ENGINE_H
+#define ENGINE_H
+
+#include "ast.h"
+#include "prefilter.h"
+#include "request.h"
+
+typedef struct ruleset_registry ruleset_registry_t;
+
+// 编译后的规则
+typedef struct compiled_rule {
+    const char* name;
+    const char* namespace_name;
+    const ast_node_t* node;
+    int ordinal;               // 在命名空间执行顺序中的位置
+    rule_filter_t filter;      // 必要条件
+} compiled_rule_t;
+
+// 编译后的命名空间: 按 after/before 排好序的规则和预过滤索引.
+// 创建后只读, 由注册表按内容去重并在多个租户的规则引擎和所有线程之间共享.
+// 注册表维护的字段在加载其他租户时会被修改, 单独占用缓存行,
+// 不会让正在求值的线程缓存的规则和索引失效.
+//
+// 覆盖合并 (base 非空) 不复制规则, 叠加在 base 与 overlay 之上:
+// base 的规则保持原有的相对顺序, overlay 的规则按 after/before 插入其间,
+// 没有约束时同名规则占据被替换规则的位置, 其余规则依次排在 base 之后.
+// 每个租户只多出与 overlay 规则数成正比的几张表
+typedef struct compiled_namespace {
+    _Alignas(CACHE_LINE_SIZE) const char* name;
+    memory_pool_t* pool;           // AST 副本、规则与索引
+    const type_t* global_type;     // 编译时使用的全局结构体类型
+    compiled_rule_t* rules;        // 按执行顺序排列, 覆盖合并时为 NULL
+    int rule_count;                // 覆盖合并时为合并后的规则数
+    int max_slots;
+    prefilter_index_t index;
+
+    struct compiled_namespace* base;     // 覆盖合并: 被覆盖的命名空间
+    struct compiled_namespace* overlay;  // 覆盖合并: 提供覆盖规则的命名空间, 不是合并
+    int* replaced;                 // base 中被替换的规则在 base 执行顺序中的位置, 升序
+    int replaced_count;
+    int* positions;                // overlay 规则序号 -> 合并后的执行顺序
+    int* by_position;              // overlay 规则按执行顺序排列的序号
+    int* ranks;                    // overlay 规则序号 -> 在 by_position 中的下标
+    int* anchors;                  // 按 by_position 顺序: 其后第一个保留的 base 规则的位置,
+                                   // 没有则为 base 的规则数. 由此推出 base 规则合并后的位置
+
+    // 注册表维护的字段
+    _Alignas(CACHE_LINE_SIZE) uint64_t hash;
+    const char* key;               // 规范化内容, 哈希相同时逐字节比较
+    size_t key_len;
+    int refcount;
+    int references_checked;        // 已执行 check_rule_references
+    struct compiled_namespace* next;
+} compiled_namespace_t;
+
+// 规则引擎: 按顺序引用若干命名空间, 自身不持有规则.
+// 创建后只读, 不引用解析器上下文, 多个线程各自用 eval_context_t 求值时无需加锁
+typedef struct rule_engine {
+    _Alignas(CACHE_LINE_SIZE) memory_pool_t* pool;
+    const feature_table_t* features;  // 注册表特征表的只读快照, 由调用方保证存活
+    const char* global_name;
+    const type_t* global_type;   // 全局结构体类型, 由类型检查构造
+    int* field_features;         // 结构体成员序号 -> 成员存在特征, 无则为 -1
+    int max_slots;               // 所有规则中最大的局部变量槽位数
+    compiled_namespace_t** namespaces;
+    int namespace_count;
+    int rule_count;
+    int max_namespace_rules;
+    ruleset_registry_t* owned_registry;  // create_rule_engine 私有的注册表
+} rule_engine_t;
+
+// 单个请求的候选规则
+typedef struct rule_selection {
+    uint64_t* scratch;         // 规则位图, 选择前后均为全零
+    int* ordinals;             // 命名空间内的候选规则序号
+    int* positions;            // 候选规则在 (合并后) 命名空间中的执行顺序
+    const compiled_rule_t** rules;  // 候选规则, 按执行顺序
+    int count;
+} rule_selection_t;
+
+// 对命名空间中的规则排序并建立索引, rules 的 AST 必须与 ns 同生命周期
+int compile_namespace_rules(compiled_namespace_t* ns, const ast_node_t** rules, int n,
+                            feature_table_t* features, const char* global_name);
+// 计算覆盖合并的执行顺序, ns 的 base 与 overlay 已设置, 表从 ns->pool 分配
+int compile_merged_rules(compiled_namespace_t* ns);
+// 按执行顺序列出命名空间的规则, out 至少 ns->rule_count 个
+int namespace_rules(const compiled_namespace_t* ns, const compiled_rule_t** out);
+// 报告 after/before 引用了命名空间中不存在的规则. 覆盖合并的两层可以互相引用,
+// 所以对合并完成后实际使用的命名空间检查
+void check_rule_references(const compiled_namespace_t* ns);
+
+// 单个程序使用私有注册表
+rule_engine_t* create_rule_engine(parser_context_t* ctx);
+// 由已编译的命名空间构造引擎, 不增加引用计数, 调用方保证命名空间存活.
+// features 为特征表的快照 (feature_snapshot_t), 求值时不读取注册表正在修改的特征表,
+// 其他租户可以同时加载
+rule_engine_t* create_rule_engine_from(compiled_namespace_t** namespaces, int count,
+                                       const feature_table_t* features);
+void destroy_rule_engine(rule_engine_t* engine);
+
+int engine_feature_id(const rule_engine_t* engine, feature_kind_t kind,
+                      const char* member, const char* key, size_t key_len);
+
+rule_selection_t* create_rule_selection(memory_pool_t* pool, const rule_engine_t* engine);
+void engine_fill_presence(const rule_engine_t* engine, const request_t* request,
+                          presence_set_t* present);
+int engine_select_rules(const rule_engine_t* engine, const presence_set_t* present,
+                        rule_selection_t* selection);
+
+void print_rule_engine(const rule_engine_t* engine);
+
+#endif // ENGINE_H
@@ -0,0 +1,94 @@
+#ifndef EVAL_H
+#define EVAL_H
+
+#include <stdint.h>
+#include "engine.h"
+#include "request.h"
+#include "sidecar.h"
+
+// 单个规则内 while/for 的最大迭代次数, 超出视为运行时错误
+#define EVAL_MAX_ITERATIONS (1 << 20)
+
+// 求值统计
+typedef struct eval_stats {
+    uint64_t requests;
+    uint64_t rules_selected;     // 预过滤后的候选规则数
+    uint64_t rules_evaluated;    // 实际执行的规则数
+    uint64_t errors;             // 运行时错误, 出错的规则按 continue 处理
+    uint64_t suspensions;        // 因等待异步查询而挂起的次数
+    uint64_t lookups;            // 发出的异步查询数
+} eval_stats_t;
+
+// 一次请求的结论
+typedef struct eval_result {
+    return_type_t verdict;
+    const compiled_rule_t* rule; // 给出结论的规则, 全部 continue 时为 NULL
+} eval_result_t;
+
+typedef enum {
+    EVAL_DONE,
+    EVAL_PENDING                 // 等待异步查询, 提交 eval_task_lookups 后再 eval_resume
+} eval_status_t;
+
+// 候选规则的执行状态
+typedef enum {
+    TASK_RULE_WAITING,           // 未执行或等待异步查询
+    TASK_RULE_CONTINUE,
+    TASK_RULE_VERDICT            // 返回了 skip 或 block
+} task_rule_state_t;
+
+// 一个请求的求值任务, 挂起时保存在这里, 其存储来自请求 arena.
+// 恢复时从头重放挂起的规则, 已完成的查询直接取结果. 唯一有副作用的是
+// rate_count 的计数, 它只在前面的规则都已得出 continue 后才发出,
+// 被前面规则拦截的请求不会计数
+typedef struct eval_task {
+    request_t* request;
+    const compiled_rule_t** rules;  // 候选规则, 按执行顺序
+    unsigned char* states;       // task_rule_state_t
+    return_type_t* verdicts;
+    int count;
+    int first;                   // 第一个未完成的候选规则
+    lookup_t* lookups;           // 本请求的全部查询, 同一查询只发一次
+    int lookup_count;
+    int lookup_capacity;
+    int submitted;               // 已提交给 sidecar 的查询数
+    eval_result_t result;
+} eval_task_t;
+
+// 求值上下文, 每个工作线程一个, 可在挂起的请求之间交替使用.
+// 求值期间的写入 (局部变量、位图、统计) 都落在上下文自己的内存池中,
+// 上下文按缓存行对齐, 与其他线程的上下文不共享缓存行
+typedef struct eval_context {
+    _Alignas(CACHE_LINE_SIZE) const rule_engine_t* engine;
+    memory_pool_t* pool;
+    value_t* slots;              // 局部变量, 按槽位号索引
+    presence_set_t* presence;
+    rule_selection_t* selection;
+    sidecar_t* sidecar;          // eval_request 同步等待时使用, 可为 NULL
+    eval_task_t* task;           // 当前任务
+    request_t* request;          // 当前请求
+    const compiled_rule_t* rule; // 当前规则
+    return_type_t verdict;       // 当前规则的返回值
+    int halted;                  // 当前规则因错误或等待查询而中止
+    int suspended;               // 中止原因是等待查询
+    int speculative;             // 前面还有等待查询的规则, 当前规则是提前执行的
+    long iterations;
+    eval_stats_t stats;
+} eval_context_t;
+
+eval_context_t* create_eval_context(const rule_engine_t* engine);
+void destroy_eval_context(eval_context_t* ctx);
+void eval_set_sidecar(eval_context_t* ctx, sidecar_t* sidecar);
+
+// 开始求值, 返回 EVAL_PENDING 时结论尚未确定
+eval_status_t eval_start(eval_context_t* ctx, eval_task_t* task, request_t* request);
+// 查询完成后继续求值
+eval_status_t eval_resume(eval_context_t* ctx, eval_task_t* task);
+// 取出尚未提交的查询, 同一次求值产生的查询合并为一批
+lookup_t* eval_task_lookups(eval_task_t* task, int* count);
+
+// 同步求值: 挂起时通过 sidecar 完成查询后继续.
+// 按执行顺序执行候选规则, 第一个非 continue 的结果即为结论
+eval_result_t eval_request(eval_context_t* ctx, request_t* request);
+
+#endif // EVAL_H
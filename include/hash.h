@@ -0,0 +1,31 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// FNV-1a, 特征表、常量集合、命名空间内容键和校验和共用
+#define FNV32_OFFSET 2166136261u
+#define FNV32_PRIME 16777619u
+#define FNV64_OFFSET 14695981039346656037ull
+#define FNV64_PRIME 1099511628211ull
+
+static inline uint32_t fnv1a_32(uint32_t h, const void* data, size_t len) {
+    const unsigned char* p = data;
+    for (size_t i = 0; i < len; i++) {
+        h ^= p[i];
+        h *= FNV32_PRIME;
+    }
+    return h;
+}
+
+static inline uint64_t fnv1a_64(uint64_t h, const void* data, size_t len) {
+    const unsigned char* p = data;
+    for (size_t i = 0; i < len; i++) {
+        h ^= p[i];
+        h *= FNV64_PRIME;
+    }
+    return h;
+}
+
+#endif // HASH_H
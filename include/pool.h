@@ -6,6 +6,9 @@
 // 内存池大小
 #define POOL_SIZE (8 * 1024)  // 8KB per pool
 
+// 缓存行大小, 线程间共享或线程私有的热数据按此对齐, 避免伪共享
+#define CACHE_LINE_SIZE 64
+
 // 内存池结构
 typedef struct memory_pool {
     char* start;           // 内存块起始位置
@@ -18,6 +21,10 @@ typedef struct memory_pool {
 memory_pool_t* create_pool(size_t size);
 void* palloc(memory_pool_t* pool, size_t size);
 char* pstrdup(memory_pool_t* pool, const char* str);
+// align 为 2 的幂
+void* palloc_aligned(memory_pool_t* pool, size_t size, size_t align);
+void reset_pool(memory_pool_t* pool);
+size_t pool_size(const memory_pool_t* pool);
 void destroy_pool(memory_pool_t* pool);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,102 @@
+#ifndef PREFILTER_H
+#define PREFILTER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "ast.h"
+
+// 特征类型
+typedef enum {
+    FEATURE_FIELD,   // 请求字段存在, 如 req.headers 或 req.headers['x-attack']
+    FEATURE_KEYWORD  // 关键字命中, 如 match_keyword('xxxx')
+} feature_kind_t;
+
+#define FEATURE_BUCKETS 256
+
+// 特征表条目
+typedef struct feature_entry {
+    feature_kind_t kind;
+    char* member;    // FEATURE_FIELD: 全局结构体成员名; FEATURE_KEYWORD: NULL
+    char* key;       // map 键或关键字, 可为 NULL, 可包含 \0
+    size_t key_len;
+    int id;          // 在存在位图中的位序号
+    struct feature_entry* next;
+} feature_entry_t;
+
+// 特征表: 把特征映射到存在位图中的位.
+// 只追加: 新条目插在桶的链表头, 已有条目和它们之后的链表不再修改
+typedef struct feature_table {
+    memory_pool_t* pool;
+    feature_entry_t* buckets[FEATURE_BUCKETS];
+    int count;
+} feature_table_t;
+
+// 特征表某一时刻的只读快照: 只复制桶头, 条目与特征表共享.
+// 之后插入的条目在桶头之前, 从快照的桶头出发看不到, 所以特征表继续插入时
+// 可以无锁地并发读取快照. 由注册表按引用计数管理,
+// 引用计数在加载其他租户时会被修改, 单独占用缓存行
+typedef struct feature_snapshot {
+    _Alignas(CACHE_LINE_SIZE) memory_pool_t* pool;
+    feature_table_t table;       // 不能再插入
+    _Alignas(CACHE_LINE_SIZE) int refcount;
+} feature_snapshot_t;
+
+// 特征集合, 编译期分析使用
+typedef struct feature_set {
+    int always;      // 无法提取条件
+    int count;
+    int* ids;
+} feature_set_t;
+
+// 规则的必要条件: 请求中至少存在一个特征时规则才可能返回非 continue
+typedef struct rule_filter {
+    int always;      // 每个请求都要执行
+    int count;       // count == 0 且 !always 表示规则永远只会 continue
+    int* features;
+} rule_filter_t;
+
+// 倒排索引: 特征 -> 规则序号 (升序, 即执行顺序).
+// 只覆盖本命名空间规则用到的特征, 大小与特征表中特征总数无关
+typedef struct prefilter_index {
+    int rule_count;
+    int word_count;          // 规则位图的 64 位字数
+    int feature_count;       // 用到的特征数
+    int* feature_ids;        // 升序
+    int* posting_offsets;    // feature_ids[k] 的倒排表为 postings[offsets[k], offsets[k + 1])
+    int* postings;
+    uint64_t* always;        // 总是需要执行的规则位图
+} prefilter_index_t;
+
+// 请求中出现的特征, 每个特征至多出现一次
+typedef struct presence_set {
+    int* ids;
+    int count;
+    int capacity;
+} presence_set_t;
+
+// 特征表
+void init_feature_table(feature_table_t* table, memory_pool_t* pool);
+int intern_feature(feature_table_t* table, feature_kind_t kind,
+                   const char* member, const char* key, size_t key_len);
+int lookup_feature(const feature_table_t* table, feature_kind_t kind,
+                   const char* member, const char* key, size_t key_len);
+feature_snapshot_t* create_feature_snapshot(const feature_table_t* table);
+void destroy_feature_snapshot(feature_snapshot_t* snapshot);
+
+// 必要条件提取
+// 特征记入 table, 条件数组分配在 pool 中
+rule_filter_t extract_rule_filter(feature_table_t* table, memory_pool_t* pool,
+                                  const char* global_name, const ast_node_t* rule);
+
+// 索引构建与候选规则选择
+int build_prefilter_index(prefilter_index_t* index, memory_pool_t* pool,
+                          const rule_filter_t* filters, int rule_count);
+int prefilter_select(const prefilter_index_t* index, const presence_set_t* present,
+                     uint64_t* scratch, int* out);
+
+// 请求特征集合, capacity 为可能出现的特征数
+presence_set_t* create_presence_set(memory_pool_t* pool, int capacity);
+void presence_set_clear(presence_set_t* set);
+void presence_set_add(presence_set_t* set, int id);
+
+#endif // PREFILTER_H
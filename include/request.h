@@ -0,0 +1,31 @@
+#ifndef REQUEST_H
+#define REQUEST_H
+
+#include "types.h"
+#include "value.h"
+
+// 一次请求的输入数据. 字符串都是指向调用方缓冲区的视图,
+// map/array 存放在请求 arena 中, request_reset 后整体复用
+typedef struct request {
+    const type_t* type;            // 全局结构体类型
+    memory_pool_t* pool;           // 请求对象自身, 生命周期与 request 相同
+    memory_pool_t* arena;          // 每个请求的临时存储
+    value_t* fields;               // 按结构体成员序号排列
+    value_t self;                  // 指向自身的 VALUE_STRUCT
+    const value_map_t* keywords;   // match_keyword 使用的关键字 -> 值
+} request_t;
+
+request_t* create_request(const type_t* type);
+void destroy_request(request_t* request);
+void request_reset(request_t* request);
+
+int request_field_index(const request_t* request, const char* name);
+void request_set_field(request_t* request, int field, value_t value);
+void request_set_keywords(request_t* request, const value_map_t* keywords);
+
+// 解析 "Name: value" 形式的头部行, 名称按原样匹配 (与 HTTP/2 一样使用小写)
+value_map_t* request_parse_headers(request_t* request, const char* buf, size_t len);
+// 解析 "k=v&k2=v2" 形式的参数
+value_map_t* request_parse_params(request_t* request, const char* buf, size_t len);
+
+#endif // REQUEST_H
@@ -0,0 +1,53 @@
+#ifndef RULESET_H
+#define RULESET_H
+
+#include "ast.h"
+#include "engine.h"
+
+#define REGISTRY_BUCKETS 256
+
+// 已编译命名空间的注册表. 内容相同 (全局结构体定义与命名空间 AST 一致) 的
+// 命名空间只保存一份, 内存随不同命名空间的数量增长, 与租户数量无关.
+// 加载与卸载由调用方串行执行
+struct ruleset_registry {
+    memory_pool_t* pool;
+    feature_table_t features;      // 所有命名空间共用, 特征序号在租户之间一致
+    feature_snapshot_t* snapshot;  // 当前的特征表快照, 特征数变化后重建, 同一代的租户共享
+    compiled_namespace_t* buckets[REGISTRY_BUCKETS];
+    int namespace_count;
+    size_t attached_memory;        // 租户、引擎和特征表快照占用的内存
+};
+
+// 租户规则集: 按顺序引用共享的命名空间, 同名命名空间后者覆盖前者的同名规则
+typedef struct tenant_ruleset {
+    char* name;
+    ruleset_registry_t* registry;
+    memory_pool_t* pool;
+    compiled_namespace_t** namespaces;
+    int namespace_count;
+    feature_snapshot_t* features;  // 引擎使用的特征表快照
+    rule_engine_t* engine;
+    size_t memory;                 // 计入注册表的租户与引擎内存
+} tenant_ruleset_t;
+
+ruleset_registry_t* create_ruleset_registry(void);
+void destroy_ruleset_registry(ruleset_registry_t* registry);
+// 注册表占用的内存: 特征表、所有命名空间, 以及租户、引擎和特征表快照
+size_t registry_memory(const ruleset_registry_t* registry);
+
+// 把类型检查通过的程序中的命名空间加入注册表, 返回按执行顺序排列、
+// 已持有引用的命名空间数组 (由调用方 free), 失败返回 NULL
+compiled_namespace_t** registry_add_program(ruleset_registry_t* registry,
+                                            parser_context_t* ctx, int* count);
+void acquire_namespace(compiled_namespace_t* ns);
+void release_namespace(ruleset_registry_t* registry, compiled_namespace_t* ns);
+// 当前特征表的快照, 返回时已持有一个引用
+feature_snapshot_t* acquire_feature_snapshot(ruleset_registry_t* registry);
+void release_feature_snapshot(ruleset_registry_t* registry, feature_snapshot_t* snapshot);
+
+// 依次加载规则文件组成租户规则集, 通常是共享的基础规则加上租户自己的规则
+tenant_ruleset_t* load_tenant_ruleset(ruleset_registry_t* registry, const char* name,
+                                      char* const* paths, int path_count);
+void destroy_tenant_ruleset(tenant_ruleset_t* tenant);
+
+#endif // RULESET_H
@@ -0,0 +1,56 @@
+#ifndef SIDECAR_H
+#define SIDECAR_H
+
+#include <stdint.h>
+#include "value.h"
+
+// 异步查询种类
+typedef enum {
+    LOOKUP_IP_REPUTATION,    // ip_reputation(ip): 信誉分
+    LOOKUP_RATE_COUNT        // rate_count(key): 计数器加一后的值
+} lookup_kind_t;
+
+typedef enum {
+    LOOKUP_PENDING,
+    LOOKUP_DONE,
+    LOOKUP_FAILED            // 查询失败, 结果按 0 处理
+} lookup_state_t;
+
+// 一次查询, 由提交方持有, sidecar 完成时原地写入结果
+typedef struct lookup {
+    lookup_kind_t kind;
+    lookup_state_t state;
+    value_t key;
+    int64_t result;
+} lookup_t;
+
+typedef struct sidecar_entry sidecar_entry_t;
+typedef struct sidecar_batch sidecar_batch_t;
+
+#define SIDECAR_BUCKETS 256
+
+// 本地 sidecar 桩服务: 一次 submit 即一次往返, poll 时按提交顺序完成
+typedef struct sidecar {
+    memory_pool_t* pool;
+    sidecar_entry_t* reputation[SIDECAR_BUCKETS];
+    sidecar_entry_t* counters[SIDECAR_BUCKETS];
+    sidecar_batch_t* head;       // 已提交未完成的批次
+    sidecar_batch_t* tail;
+    sidecar_batch_t* free_list;
+    uint64_t round_trips;
+    uint64_t lookups;
+} sidecar_t;
+
+sidecar_t* create_sidecar(void);
+void destroy_sidecar(sidecar_t* sidecar);
+
+void sidecar_set_reputation(sidecar_t* sidecar, const char* ip, int64_t score);
+
+// 提交一批查询, lookups 在完成前必须保持有效
+int sidecar_submit(sidecar_t* sidecar, lookup_t* lookups, int count, void* token);
+// 完成最早提交的批次并返回其 token, 没有待完成批次时返回 NULL
+void* sidecar_poll(sidecar_t* sidecar);
+// 只完成 token 最早提交的批次, 其他批次留在队列中, 没有该批次时返回 -1
+int sidecar_complete(sidecar_t* sidecar, void* token);
+
+#endif // SIDECAR_H
@@ -0,0 +1,72 @@
+#ifndef TYPES_H
+#define TYPES_H
+
+#include <stddef.h>
+#include "ast.h"
+
+// 类型种类
+typedef enum {
+    TYPE_NIL,
+    TYPE_INT,
+    TYPE_FLOAT,
+    TYPE_STRING,
+    TYPE_MAP,
+    TYPE_ARRAY,
+    TYPE_STRUCT
+} type_kind_t;
+
+// 结构体成员
+typedef struct struct_field {
+    const char* name;
+    const type_t* type;
+} struct_field_t;
+
+// 类型描述
+struct type {
+    type_kind_t kind;
+    const type_t* key;         // map 键类型
+    const type_t* elem;        // map 值类型或 array 元素类型
+    const char* name;          // 结构体名
+    struct_field_t* fields;    // 结构体成员
+    int field_count;
+};
+
+// 基本类型单例
+extern const type_t type_nil;
+extern const type_t type_int;
+extern const type_t type_float;
+extern const type_t type_string;
+
+// 内置函数
+typedef enum {
+    BUILTIN_NONE,
+    BUILTIN_MATCH_KEYWORD,
+    BUILTIN_MATCH_KEYWORD_VALUE,
+    BUILTIN_IP_REPUTATION,     // 异步, 由 sidecar 查询
+    BUILTIN_RATE_COUNT         // 异步, 由 sidecar 查询
+} builtin_id_t;
+
+#define BUILTIN_MAX_ARGS 4
+
+// 内置函数签名
+typedef struct builtin_info {
+    builtin_id_t id;
+    const char* name;
+    int arg_count;
+    const type_t* args[BUILTIN_MAX_ARGS];
+    const type_t* result;
+} builtin_info_t;
+
+const type_t* parse_type_spec(memory_pool_t* pool, const char* spec);
+const type_t* create_map_type(memory_pool_t* pool, const type_t* key, const type_t* elem);
+const type_t* create_array_type(memory_pool_t* pool, const type_t* elem);
+
+int type_equal(const type_t* a, const type_t* b);
+int type_is_numeric(const type_t* t);
+int type_is_nullable(const type_t* t);
+int struct_field_index(const type_t* t, const char* name);
+const char* type_to_string(const type_t* t, char* buf, size_t size);
+
+const builtin_info_t* find_builtin(const char* name);
+
+#endif // TYPES_H
@@ -0,0 +1,142 @@
+#ifndef VALUE_H
+#define VALUE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "pool.h"
+
+// 运行时值标签
+typedef enum {
+    VALUE_NIL,
+    VALUE_INT,
+    VALUE_FLOAT,
+    VALUE_SMALL_STR,   // 短字符串, 直接存放在值内
+    VALUE_STR,         // 字符串视图, 指向请求缓冲区、字面量或请求 arena
+    VALUE_MAP,
+    VALUE_ARRAY,
+    VALUE_STRUCT       // 全局请求结构体
+} value_tag_t;
+
+#define VALUE_SMALL_MAX 14
+
+typedef struct value_map value_map_t;
+typedef struct value_array value_array_t;
+typedef struct value_set value_set_t;
+typedef struct type type_t;
+
+// 16 字节带标签的值, 各成员的第一个字节都是标签
+typedef union value {
+    uint8_t tag;
+    struct { uint8_t tag; uint8_t len; char data[VALUE_SMALL_MAX]; } small;
+    struct { uint8_t tag; uint32_t len; const char* ptr; } str;
+    struct { uint8_t tag; int64_t value; } i;
+    struct { uint8_t tag; double value; } f;
+    struct { uint8_t tag; const value_map_t* ptr; } map;
+    struct { uint8_t tag; const value_array_t* ptr; } array;
+    struct { uint8_t tag; const void* ptr; } object;
+} value_t;
+
+_Static_assert(sizeof(value_t) == 16, "value_t must be 16 bytes");
+
+// map, 键值按插入顺序保存, 存储来自请求 arena
+struct value_map {
+    int count;
+    int capacity;
+    value_t* keys;
+    value_t* values;
+};
+
+// 数组, 存储来自请求 arena
+struct value_array {
+    int count;
+    value_t* items;
+};
+
+// 常量集合, 开放寻址哈希表, 加载时构建后只读
+struct value_set {
+    int count;
+    uint32_t mask;       // 槽位数 - 1, 槽位数为 2 的幂且不小于元素数的两倍
+    uint32_t* hashes;
+    value_t* slots;      // 空槽为 VALUE_NIL
+};
+
+static inline value_t value_nil(void) {
+    value_t v;
+    v.i.tag = VALUE_NIL;
+    v.i.value = 0;
+    return v;
+}
+
+static inline value_t value_int(int64_t i) {
+    value_t v;
+    v.i.tag = VALUE_INT;
+    v.i.value = i;
+    return v;
+}
+
+static inline value_t value_float(double f) {
+    value_t v;
+    v.f.tag = VALUE_FLOAT;
+    v.f.value = f;
+    return v;
+}
+
+// 不复制的字符串视图, 调用方保证 ptr 在请求期间有效
+static inline value_t value_view(const char* ptr, size_t len) {
+    value_t v;
+    v.str.tag = VALUE_STR;
+    v.str.len = (uint32_t)len;
+    v.str.ptr = ptr;
+    return v;
+}
+
+static inline value_t value_from_map(const value_map_t* map) {
+    value_t v;
+    v.map.tag = map ? VALUE_MAP : VALUE_NIL;
+    v.map.ptr = map;
+    return v;
+}
+
+static inline value_t value_from_array(const value_array_t* array) {
+    value_t v;
+    v.array.tag = array ? VALUE_ARRAY : VALUE_NIL;
+    v.array.ptr = array;
+    return v;
+}
+
+static inline int value_is_nil(const value_t* v) {
+    return v->tag == VALUE_NIL;
+}
+
+static inline int value_is_string(const value_t* v) {
+    return v->tag == VALUE_SMALL_STR || v->tag == VALUE_STR;
+}
+
+// 字符串数据, 短字符串指向值内部, 值被复制后需重新获取
+static inline const char* value_str_data(const value_t* v) {
+    return v->tag == VALUE_SMALL_STR ? v->small.data : v->str.ptr;
+}
+
+static inline size_t value_str_len(const value_t* v) {
+    return v->tag == VALUE_SMALL_STR ? v->small.len : v->str.len;
+}
+
+value_t value_zero(const type_t* t);
+value_t value_string(memory_pool_t* arena, const char* ptr, size_t len);
+value_t value_concat(memory_pool_t* arena, const value_t* a, const value_t* b);
+int value_str_compare(const value_t* a, const value_t* b);
+int value_str_equal(const value_t* a, const char* ptr, size_t len);
+int value_key_equal(const value_t* a, const value_t* b);
+
+value_map_t* create_value_map(memory_pool_t* arena, int capacity);
+int value_map_put(value_map_t* map, value_t key, value_t value);
+const value_t* value_map_get(const value_map_t* map, const value_t* key);
+const value_t* value_map_find(const value_map_t* map, const char* key, size_t len);
+
+value_array_t* create_value_array(memory_pool_t* arena, int count);
+
+uint32_t value_hash(const value_t* v);
+value_set_t* create_value_set(memory_pool_t* pool, const value_t* items, int count);
+int value_set_contains(const value_set_t* set, const value_t* v);
+
+#endif // VALUE_H
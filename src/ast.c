@@ -3,6 +3,9 @@
 #include <string.h>
 #include "pool.h"
 #include "ast.h"
+#include "types.h"
+
+extern int yylineno;
 
 // 颜色代码
 #define COLOR_RESET   "\x1b[0m"
@@ -71,10 +74,18 @@ symbol_entry_t* add_symbol(parser_context_t* ctx, const char* name, const char*
     
     symbol->name = pstrdup(pool, name);
     symbol->type = pstrdup(pool, type);
+    symbol->value_type = NULL;
+    symbol->slot = -1;
     symbol->scope = ctx->current_scope;
     
-    symbol->next = ctx->symbol_table;
-    ctx->symbol_table = symbol;
+    // 作用域内的符号随作用域释放, 不能挂到全局符号表上
+    if (ctx->current_scope) {
+        symbol->next = ctx->current_scope->symbols;
+        ctx->current_scope->symbols = symbol;
+    } else {
+        symbol->next = ctx->symbol_table;
+        ctx->symbol_table = symbol;
+    }
     
     return symbol;
 }
@@ -94,6 +105,8 @@ ast_node_t* create_ast_node(parser_context_t* ctx, ast_node_type_t type) {
     ast_node_t* node = palloc(ctx->pool, sizeof(ast_node_t));
     if (node) {
         node->type = type;
+        node->line = yylineno;
+        node->value_type = NULL;
         memset(&node->data, 0, sizeof(node->data));
     }
     return node;
@@ -125,10 +138,56 @@ ast_node_t* create_identifier_node(parser_context_t* ctx, const char* name) {
     return node;
 }
 
+static int hex_digit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// 去掉两侧引号并解码转义序列, 返回解码后的长度
+static size_t decode_string_literal(const char* src, char* dst) {
+    size_t len = strlen(src);
+    size_t n = 0;
+
+    if (len >= 2 && (src[0] == '"' || src[0] == '\'') && src[len - 1] == src[0]) {
+        src++;
+        len -= 2;
+    }
+
+    for (size_t i = 0; i < len; i++) {
+        if (src[i] != '\\' || i + 1 >= len) {
+            dst[n++] = src[i];
+            continue;
+        }
+        switch (src[++i]) {
+            case 'n': dst[n++] = '\n'; break;
+            case 't': dst[n++] = '\t'; break;
+            case 'r': dst[n++] = '\r'; break;
+            case '0': dst[n++] = '\0'; break;
+            case 'x':
+                if (i + 2 < len && hex_digit(src[i + 1]) >= 0 && hex_digit(src[i + 2]) >= 0) {
+                    dst[n++] = (char)(hex_digit(src[i + 1]) * 16 + hex_digit(src[i + 2]));
+                    i += 2;
+                } else {
+                    dst[n++] = 'x';
+                }
+                break;
+            default: dst[n++] = src[i]; break;  // \\ \' \" 及未知转义
+        }
+    }
+    dst[n] = '\0';
+    return n;
+}
+
+// 字符串字面量在加载时完成去引号和转义解码, 求值时直接引用
 ast_node_t* create_string_literal_node(parser_context_t* ctx, const char* value) {
     ast_node_t* node = create_ast_node(ctx, AST_STRING_LITERAL);
     if (node) {
-        node->data.string_literal.value = pstrdup(ctx->pool, value);
+        char* text = palloc(ctx->pool, strlen(value) + 1);
+        if (!text) return NULL;
+        node->data.string_literal.length = decode_string_literal(value, text);
+        node->data.string_literal.value = text;
     }
     return node;
 }
@@ -195,6 +254,66 @@ static const char* operator_to_string(operator_type_t op) {
         case OP_BXOR_ASSIGN: return "^=";
         case OP_LSHIFT_ASSIGN: return "<<=";
         case OP_RSHIFT_ASSIGN: return ">>=";
+        case OP_IN: return "in";
+        case OP_TO_FLOAT: return "float()";
+        default: return "unknown";
+    }
+}
+
+// 操作码字符串表
+static const char* opcode_to_string(opcode_t opcode) {
+    switch (opcode) {
+        case OPC_NONE: return "none";
+        case OPC_INT_ADD: return "int_add";
+        case OPC_INT_SUB: return "int_sub";
+        case OPC_INT_MUL: return "int_mul";
+        case OPC_INT_DIV: return "int_div";
+        case OPC_INT_MOD: return "int_mod";
+        case OPC_INT_BAND: return "int_band";
+        case OPC_INT_BOR: return "int_bor";
+        case OPC_INT_BXOR: return "int_bxor";
+        case OPC_INT_LSHIFT: return "int_lshift";
+        case OPC_INT_RSHIFT: return "int_rshift";
+        case OPC_INT_EQ: return "int_eq";
+        case OPC_INT_NE: return "int_ne";
+        case OPC_INT_GT: return "int_gt";
+        case OPC_INT_LT: return "int_lt";
+        case OPC_INT_GE: return "int_ge";
+        case OPC_INT_LE: return "int_le";
+        case OPC_INT_NEG: return "int_neg";
+        case OPC_INT_NOT: return "int_not";
+        case OPC_INT_INC: return "int_inc";
+        case OPC_INT_DEC: return "int_dec";
+        case OPC_INT_TO_FLOAT: return "int_to_float";
+        case OPC_FLOAT_ADD: return "float_add";
+        case OPC_FLOAT_SUB: return "float_sub";
+        case OPC_FLOAT_MUL: return "float_mul";
+        case OPC_FLOAT_DIV: return "float_div";
+        case OPC_FLOAT_EQ: return "float_eq";
+        case OPC_FLOAT_NE: return "float_ne";
+        case OPC_FLOAT_GT: return "float_gt";
+        case OPC_FLOAT_LT: return "float_lt";
+        case OPC_FLOAT_GE: return "float_ge";
+        case OPC_FLOAT_LE: return "float_le";
+        case OPC_FLOAT_NEG: return "float_neg";
+        case OPC_FLOAT_INC: return "float_inc";
+        case OPC_FLOAT_DEC: return "float_dec";
+        case OPC_STR_CONCAT: return "str_concat";
+        case OPC_STR_EQ: return "str_eq";
+        case OPC_STR_NE: return "str_ne";
+        case OPC_STR_GT: return "str_gt";
+        case OPC_STR_LT: return "str_lt";
+        case OPC_STR_GE: return "str_ge";
+        case OPC_STR_LE: return "str_le";
+        case OPC_NIL_EQ: return "nil_eq";
+        case OPC_NIL_NE: return "nil_ne";
+        case OPC_AND: return "and";
+        case OPC_OR: return "or";
+        case OPC_IN_SET: return "in_set";
+        case OPC_IN_ARRAY: return "in_array";
+        case OPC_IN_MAP: return "in_map";
+        case OPC_INDEX_MAP: return "index_map";
+        case OPC_INDEX_ARRAY: return "index_array";
         default: return "unknown";
     }
 }
@@ -249,6 +368,22 @@ void print_ast(const ast_node_t* root, int indent) {
         case AST_RULE:
             printf("%s%s├── Rule: %s%s\n", indent_str, COLOR_MAGENTA, 
                    root->data.rule.name, COLOR_RESET);
+            if (root->data.rule.after_rules) {
+                printf("%s  %s├── After:%s\n", indent_str, COLOR_CYAN, COLOR_RESET);
+                ast_list_t* dep = root->data.rule.after_rules;
+                while (dep) {
+                    print_ast(dep->node, indent + 2);
+                    dep = dep->next;
+                }
+            }
+            if (root->data.rule.before_rules) {
+                printf("%s  %s├── Before:%s\n", indent_str, COLOR_CYAN, COLOR_RESET);
+                ast_list_t* dep = root->data.rule.before_rules;
+                while (dep) {
+                    print_ast(dep->node, indent + 2);
+                    dep = dep->next;
+                }
+            }
             if (root->data.rule.body) {
                 printf("%s  %s└── Body:%s\n", indent_str, COLOR_CYAN, COLOR_RESET);
                 ast_list_t* stmt = root->data.rule.body;
@@ -267,8 +402,16 @@ void print_ast(const ast_node_t* root, int indent) {
             break;
             
         case AST_LET_STMT:
-            printf("%s%s├── Let: %s%s\n", indent_str, COLOR_CYAN,
-                   root->data.let_stmt.name, COLOR_RESET);
+            if (root->value_type) {
+                char type_buf[128];
+                printf("%s%s├── Let: %s (type: %s)%s\n", indent_str, COLOR_CYAN,
+                       root->data.let_stmt.name,
+                       type_to_string(root->value_type, type_buf, sizeof(type_buf)),
+                       COLOR_RESET);
+            } else {
+                printf("%s%s├── Let: %s%s\n", indent_str, COLOR_CYAN,
+                       root->data.let_stmt.name, COLOR_RESET);
+            }
             if (root->data.let_stmt.init) {
                 print_ast(root->data.let_stmt.init, indent + 1);
             }
@@ -360,7 +503,12 @@ void print_ast(const ast_node_t* root, int indent) {
             break;
 
         case AST_MAP_ACCESS:
-            printf("%s%s├── Map Access%s\n", indent_str, COLOR_YELLOW, COLOR_RESET);
+            if (root->data.map_access.opcode != OPC_NONE) {
+                printf("%s%s├── Map Access [%s]%s\n", indent_str, COLOR_YELLOW,
+                       opcode_to_string(root->data.map_access.opcode), COLOR_RESET);
+            } else {
+                printf("%s%s├── Map Access%s\n", indent_str, COLOR_YELLOW, COLOR_RESET);
+            }
             printf("%s  %s├── Target:%s\n", indent_str, COLOR_CYAN, COLOR_RESET);
             print_ast(root->data.map_access.target, indent + 2);
             printf("%s  %s└── Key:%s\n", indent_str, COLOR_CYAN, COLOR_RESET);
@@ -375,8 +523,14 @@ void print_ast(const ast_node_t* root, int indent) {
             break;
             
         case AST_BINARY_EXPR:
-            printf("%s%s├── Binary: %s%s\n", indent_str, COLOR_MAGENTA,
-                   operator_to_string(root->data.binary_expr.op), COLOR_RESET);
+            if (root->data.binary_expr.opcode != OPC_NONE) {
+                printf("%s%s├── Binary: %s [%s]%s\n", indent_str, COLOR_MAGENTA,
+                       operator_to_string(root->data.binary_expr.op),
+                       opcode_to_string(root->data.binary_expr.opcode), COLOR_RESET);
+            } else {
+                printf("%s%s├── Binary: %s%s\n", indent_str, COLOR_MAGENTA,
+                       operator_to_string(root->data.binary_expr.op), COLOR_RESET);
+            }
             printf("%s  %s├── Left:%s\n", indent_str, COLOR_CYAN, COLOR_RESET);
             print_ast(root->data.binary_expr.left, indent + 2);
             printf("%s  %s└── Right:%s\n", indent_str, COLOR_CYAN, COLOR_RESET);
@@ -384,8 +538,14 @@ void print_ast(const ast_node_t* root, int indent) {
             break;
 
         case AST_UNARY_EXPR:
-            printf("%s%s├── Unary: %s%s\n", indent_str, COLOR_MAGENTA,
-                   operator_to_string(root->data.unary_expr.op), COLOR_RESET);
+            if (root->data.unary_expr.opcode != OPC_NONE) {
+                printf("%s%s├── Unary: %s [%s]%s\n", indent_str, COLOR_MAGENTA,
+                       operator_to_string(root->data.unary_expr.op),
+                       opcode_to_string(root->data.unary_expr.opcode), COLOR_RESET);
+            } else {
+                printf("%s%s├── Unary: %s%s\n", indent_str, COLOR_MAGENTA,
+                       operator_to_string(root->data.unary_expr.op), COLOR_RESET);
+            }
             printf("%s  %s└── Operand:%s\n", indent_str, COLOR_CYAN, COLOR_RESET);
             print_ast(root->data.unary_expr.operand, indent + 2);
             break;
@@ -0,0 +1,795 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include "checker.h"
+#include "types.h"
+#include "value.h"
+
+// 类型检查上下文
+typedef struct checker {
+    parser_context_t* ctx;
+    const type_t* global_type;   // 全局结构体类型
+    const char* global_name;
+    const ast_node_t* rule;      // 当前规则
+    int slot_count;              // 当前规则已分配的槽位数
+    int errors;
+} checker_t;
+
+static void type_error(checker_t* ck, const ast_node_t* node, const char* fmt, ...) {
+    va_list args;
+
+    fprintf(stderr, "Type error at line %d", node ? node->line : 0);
+    if (ck->rule) {
+        fprintf(stderr, " in rule %s", ck->rule->data.rule.name);
+    }
+    fprintf(stderr, ": ");
+    va_start(args, fmt);
+    vfprintf(stderr, fmt, args);
+    va_end(args);
+    fprintf(stderr, "\n");
+
+    ck->errors++;
+    ck->ctx->error_count++;
+}
+
+static ast_node_t* make_node(checker_t* ck, ast_node_type_t type, const ast_node_t* origin) {
+    ast_node_t* node = create_ast_node(ck->ctx, type);
+    if (node) node->line = origin->line;
+    return node;
+}
+
+static ast_node_t* make_nil(checker_t* ck, const ast_node_t* origin) {
+    ast_node_t* node = make_node(ck, AST_IDENTIFIER, origin);
+    if (node) {
+        node->data.identifier.name = pstrdup(ck->ctx->pool, "nil");
+        node->data.identifier.slot = -1;
+        node->value_type = &type_nil;
+    }
+    return node;
+}
+
+// 在 int 表达式外包一层 int -> float 转换, 整数字面量直接改写为浮点字面量
+static void convert_to_float(checker_t* ck, ast_node_t** pexpr) {
+    ast_node_t* expr = *pexpr;
+    if (expr->type == AST_INTEGER_LITERAL) {
+        double value = (double)expr->data.integer_literal.value;
+        expr->type = AST_FLOAT_LITERAL;
+        expr->data.float_literal.value = value;
+        expr->value_type = &type_float;
+        return;
+    }
+
+    ast_node_t* node = make_node(ck, AST_UNARY_EXPR, expr);
+    if (!node) return;
+    node->data.unary_expr.op = OP_TO_FLOAT;
+    node->data.unary_expr.opcode = OPC_INT_TO_FLOAT;
+    node->data.unary_expr.operand = expr;
+    node->value_type = &type_float;
+    *pexpr = node;
+}
+
+// 把 have 类型的表达式转换为 want 类型, 不兼容时返回 0
+static int coerce(checker_t* ck, ast_node_t** pexpr, const type_t* have, const type_t* want) {
+    if (!have || !want) return 1;  // 之前已报告过错误
+    if (type_equal(have, want)) return 1;
+    if (have->kind == TYPE_INT && want->kind == TYPE_FLOAT) {
+        convert_to_float(ck, pexpr);
+        return 1;
+    }
+    if (have->kind == TYPE_NIL && type_is_nullable(want)) return 1;
+    return 0;
+}
+
+static opcode_t arith_opcode(operator_type_t op, type_kind_t kind) {
+    if (kind == TYPE_INT) {
+        switch (op) {
+            case OP_ADD: return OPC_INT_ADD;
+            case OP_SUB: return OPC_INT_SUB;
+            case OP_MUL: return OPC_INT_MUL;
+            case OP_DIV: return OPC_INT_DIV;
+            case OP_MOD: return OPC_INT_MOD;
+            case OP_BAND: return OPC_INT_BAND;
+            case OP_BOR: return OPC_INT_BOR;
+            case OP_BXOR: return OPC_INT_BXOR;
+            case OP_LSHIFT: return OPC_INT_LSHIFT;
+            case OP_RSHIFT: return OPC_INT_RSHIFT;
+            default: return OPC_NONE;
+        }
+    }
+    if (kind == TYPE_FLOAT) {
+        switch (op) {
+            case OP_ADD: return OPC_FLOAT_ADD;
+            case OP_SUB: return OPC_FLOAT_SUB;
+            case OP_MUL: return OPC_FLOAT_MUL;
+            case OP_DIV: return OPC_FLOAT_DIV;
+            default: return OPC_NONE;
+        }
+    }
+    if (kind == TYPE_STRING && op == OP_ADD) {
+        return OPC_STR_CONCAT;
+    }
+    return OPC_NONE;
+}
+
+static opcode_t compare_opcode(operator_type_t op, type_kind_t kind) {
+    static const opcode_t int_ops[] = {
+        OPC_INT_EQ, OPC_INT_NE, OPC_INT_GT, OPC_INT_LT, OPC_INT_GE, OPC_INT_LE
+    };
+    static const opcode_t float_ops[] = {
+        OPC_FLOAT_EQ, OPC_FLOAT_NE, OPC_FLOAT_GT, OPC_FLOAT_LT, OPC_FLOAT_GE, OPC_FLOAT_LE
+    };
+    static const opcode_t str_ops[] = {
+        OPC_STR_EQ, OPC_STR_NE, OPC_STR_GT, OPC_STR_LT, OPC_STR_GE, OPC_STR_LE
+    };
+
+    if (op < OP_EQ || op > OP_LE) return OPC_NONE;
+    switch (kind) {
+        case TYPE_INT: return int_ops[op - OP_EQ];
+        case TYPE_FLOAT: return float_ops[op - OP_EQ];
+        case TYPE_STRING: return str_ops[op - OP_EQ];
+        default: return OPC_NONE;
+    }
+}
+
+static operator_type_t compound_base(operator_type_t op) {
+    switch (op) {
+        case OP_ADD_ASSIGN: return OP_ADD;
+        case OP_SUB_ASSIGN: return OP_SUB;
+        case OP_MUL_ASSIGN: return OP_MUL;
+        case OP_DIV_ASSIGN: return OP_DIV;
+        case OP_MOD_ASSIGN: return OP_MOD;
+        case OP_BAND_ASSIGN: return OP_BAND;
+        case OP_BOR_ASSIGN: return OP_BOR;
+        case OP_BXOR_ASSIGN: return OP_BXOR;
+        case OP_LSHIFT_ASSIGN: return OP_LSHIFT;
+        case OP_RSHIFT_ASSIGN: return OP_RSHIFT;
+        default: return op;
+    }
+}
+
+static const type_t* type_of_kind(type_kind_t kind) {
+    switch (kind) {
+        case TYPE_INT: return &type_int;
+        case TYPE_FLOAT: return &type_float;
+        case TYPE_STRING: return &type_string;
+        default: return &type_nil;
+    }
+}
+
+static const type_t* check_expr(checker_t* ck, ast_node_t** pexpr);
+
+// 条件表达式统一规约为 int: float 与 0.0 比较, 可为 nil 的值与 nil 比较
+static int check_condition(checker_t* ck, ast_node_t** pexpr) {
+    char name[128];
+    const type_t* t = check_expr(ck, pexpr);
+    if (!t) return 0;
+
+    ast_node_t* expr = *pexpr;
+    ast_node_t* node;
+    switch (t->kind) {
+        case TYPE_INT:
+            return 1;
+
+        case TYPE_FLOAT:
+            node = make_node(ck, AST_BINARY_EXPR, expr);
+            node->data.binary_expr.op = OP_NE;
+            node->data.binary_expr.opcode = OPC_FLOAT_NE;
+            node->data.binary_expr.left = expr;
+            node->data.binary_expr.right = create_float_literal_node(ck->ctx, 0.0);
+            node->data.binary_expr.right->value_type = &type_float;
+            node->value_type = &type_int;
+            *pexpr = node;
+            return 1;
+
+        case TYPE_NIL:
+        case TYPE_STRING:
+        case TYPE_MAP:
+        case TYPE_ARRAY:
+            node = make_node(ck, AST_BINARY_EXPR, expr);
+            node->data.binary_expr.op = OP_NE;
+            node->data.binary_expr.opcode = OPC_NIL_NE;
+            node->data.binary_expr.left = expr;
+            node->data.binary_expr.right = make_nil(ck, expr);
+            node->value_type = &type_int;
+            *pexpr = node;
+            return 1;
+
+        default:
+            type_error(ck, expr, "cannot use %s as a condition",
+                       type_to_string(t, name, sizeof(name)));
+            return 0;
+    }
+}
+
+// 取成员或下标访问链最内层的标识符
+static const ast_node_t* access_root(const ast_node_t* node) {
+    while (node) {
+        if (node->type == AST_MEMBER_ACCESS) {
+            node = node->data.member_access.target;
+        } else if (node->type == AST_MAP_ACCESS) {
+            node = node->data.map_access.target;
+        } else {
+            break;
+        }
+    }
+    return node;
+}
+
+// 赋值目标必须是局部变量, 全局请求结构体只读
+static int check_local_target(checker_t* ck, const ast_node_t* target) {
+    if (target->type == AST_IDENTIFIER && target->data.identifier.slot >= 0) {
+        return 1;
+    }
+
+    const ast_node_t* root = access_root(target);
+    if (root && root->type == AST_IDENTIFIER && root->data.identifier.slot < 0 &&
+        ck->global_name && strcmp(root->data.identifier.name, ck->global_name) == 0) {
+        type_error(ck, target, "global %s is read-only", ck->global_name);
+    } else if (target->type == AST_IDENTIFIER &&
+               strcmp(target->data.identifier.name, "nil") == 0) {
+        type_error(ck, target, "cannot assign to nil");
+    } else if (target->type != AST_IDENTIFIER) {
+        // 未声明的标识符已经报告过
+        type_error(ck, target, "expression is not assignable, only local variables are");
+    }
+    return 0;
+}
+
+static const type_t* check_identifier(checker_t* ck, ast_node_t* node) {
+    const char* name = node->data.identifier.name;
+    node->data.identifier.slot = -1;
+
+    if (strcmp(name, "nil") == 0) {
+        return &type_nil;
+    }
+
+    symbol_entry_t* sym = find_symbol(ck->ctx, name);
+    if (sym && sym->slot >= 0) {
+        node->data.identifier.slot = sym->slot;
+        return sym->value_type;
+    }
+
+    if (ck->global_name && strcmp(name, ck->global_name) == 0) {
+        return ck->global_type;
+    }
+
+    type_error(ck, node, "undeclared identifier '%s'", name);
+    return NULL;
+}
+
+static const type_t* check_array_literal(checker_t* ck, ast_node_t* node) {
+    char a[128], b[128];
+    const type_t* elem = NULL;
+    int has_float = 0, all_numeric = 1;
+
+    if (!node->data.array_literal.items) {
+        type_error(ck, node, "cannot infer element type of empty array literal");
+        return NULL;
+    }
+
+    for (ast_list_t* item = node->data.array_literal.items; item; item = item->next) {
+        const type_t* t = check_expr(ck, &item->node);
+        if (!t) return NULL;
+        if (t->kind == TYPE_FLOAT) has_float = 1;
+        if (!type_is_numeric(t)) all_numeric = 0;
+        if (!elem || elem->kind == TYPE_NIL) elem = t;
+    }
+    if (all_numeric && has_float) elem = &type_float;
+
+    for (ast_list_t* item = node->data.array_literal.items; item; item = item->next) {
+        if (!coerce(ck, &item->node, item->node->value_type, elem)) {
+            type_error(ck, item->node, "array element of type %s does not match %s",
+                       type_to_string(item->node->value_type, a, sizeof(a)),
+                       type_to_string(elem, b, sizeof(b)));
+            return NULL;
+        }
+    }
+    if (elem->kind == TYPE_NIL) {
+        type_error(ck, node, "cannot infer element type of array of nil");
+        return NULL;
+    }
+    return create_array_type(ck->ctx->pool, elem);
+}
+
+static const type_t* check_member_access(checker_t* ck, ast_node_t* node) {
+    char name[128];
+    const type_t* t = check_expr(ck, &node->data.member_access.target);
+    if (!t) return NULL;
+
+    if (t->kind != TYPE_STRUCT) {
+        type_error(ck, node, "cannot access member '%s' of %s",
+                   node->data.member_access.member, type_to_string(t, name, sizeof(name)));
+        return NULL;
+    }
+
+    int field = struct_field_index(t, node->data.member_access.member);
+    if (field < 0) {
+        type_error(ck, node, "%s has no member '%s'", t->name, node->data.member_access.member);
+        return NULL;
+    }
+    node->data.member_access.field = field;
+    return t->fields[field].type;
+}
+
+static const type_t* check_map_access(checker_t* ck, ast_node_t* node) {
+    char a[128], b[128];
+    const type_t* t = check_expr(ck, &node->data.map_access.target);
+    const type_t* k = check_expr(ck, &node->data.map_access.key);
+    if (!t || !k) return NULL;
+
+    const type_t* want;
+    opcode_t opcode;
+    if (t->kind == TYPE_MAP) {
+        want = t->key;
+        opcode = OPC_INDEX_MAP;
+    } else if (t->kind == TYPE_ARRAY) {
+        want = &type_int;
+        opcode = OPC_INDEX_ARRAY;
+    } else {
+        type_error(ck, node, "cannot index %s", type_to_string(t, a, sizeof(a)));
+        return NULL;
+    }
+
+    if (k->kind == TYPE_NIL || !coerce(ck, &node->data.map_access.key, k, want)) {
+        type_error(ck, node, "index of type %s used with %s",
+                   type_to_string(k, a, sizeof(a)), type_to_string(t, b, sizeof(b)));
+        return NULL;
+    }
+    node->data.map_access.opcode = opcode;
+    return t->elem;
+}
+
+static const type_t* check_func_call(checker_t* ck, ast_node_t* node) {
+    char a[128], b[128];
+    const builtin_info_t* info = find_builtin(node->data.func_call.name);
+    if (!info) {
+        type_error(ck, node, "unknown function '%s'", node->data.func_call.name);
+        return NULL;
+    }
+
+    int argc = 0;
+    int ok = 1;
+    for (ast_list_t* arg = node->data.func_call.args; arg; arg = arg->next, argc++) {
+        const type_t* t = check_expr(ck, &arg->node);
+        if (!t) {
+            ok = 0;
+            continue;
+        }
+        if (argc < info->arg_count && !coerce(ck, &arg->node, t, info->args[argc])) {
+            type_error(ck, arg->node, "argument %d of %s must be %s, got %s", argc + 1,
+                       info->name, type_to_string(info->args[argc], a, sizeof(a)),
+                       type_to_string(t, b, sizeof(b)));
+            ok = 0;
+        }
+    }
+    if (argc != info->arg_count) {
+        type_error(ck, node, "%s expects %d arguments, got %d",
+                   info->name, info->arg_count, argc);
+        return NULL;
+    }
+
+    node->data.func_call.builtin = info->id;
+    return ok ? info->result : NULL;
+}
+
+static const type_t* check_unary(checker_t* ck, ast_node_t* node) {
+    char name[128];
+    const type_t* t = NULL;
+
+    switch (node->data.unary_expr.op) {
+        case OP_MINUS:
+            t = check_expr(ck, &node->data.unary_expr.operand);
+            if (!t) return NULL;
+            if (!type_is_numeric(t)) break;
+            node->data.unary_expr.opcode = t->kind == TYPE_INT ? OPC_INT_NEG : OPC_FLOAT_NEG;
+            return t;
+
+        case OP_NOT:
+            if (!check_condition(ck, &node->data.unary_expr.operand)) return NULL;
+            node->data.unary_expr.opcode = OPC_INT_NOT;
+            return &type_int;
+
+        case OP_INC:
+        case OP_DEC:
+            t = check_expr(ck, &node->data.unary_expr.operand);
+            if (!t) return NULL;
+            if (!check_local_target(ck, node->data.unary_expr.operand)) return NULL;
+            if (!type_is_numeric(t)) break;
+            if (node->data.unary_expr.op == OP_INC) {
+                node->data.unary_expr.opcode = t->kind == TYPE_INT ? OPC_INT_INC : OPC_FLOAT_INC;
+            } else {
+                node->data.unary_expr.opcode = t->kind == TYPE_INT ? OPC_INT_DEC : OPC_FLOAT_DEC;
+            }
+            return t;
+
+        case OP_TO_FLOAT:
+            return &type_float;
+
+        default:
+            type_error(ck, node, "unsupported unary operator");
+            return NULL;
+    }
+
+    type_error(ck, node, "invalid operand of type %s for unary operator",
+               type_to_string(t, name, sizeof(name)));
+    return NULL;
+}
+
+// 复合赋值: 目标必须是局部变量, 结果类型必须与变量类型一致
+static const type_t* check_compound_assign(checker_t* ck, ast_node_t* node) {
+    char a[128], b[128];
+    const type_t* lt = check_expr(ck, &node->data.binary_expr.left);
+    const type_t* rt = check_expr(ck, &node->data.binary_expr.right);
+    if (!lt || !rt) return NULL;
+    if (!check_local_target(ck, node->data.binary_expr.left)) return NULL;
+
+    if (lt->kind == TYPE_FLOAT && rt->kind == TYPE_INT) {
+        convert_to_float(ck, &node->data.binary_expr.right);
+        rt = &type_float;
+    }
+
+    opcode_t opcode = OPC_NONE;
+    if (lt->kind == rt->kind) {
+        opcode = arith_opcode(compound_base(node->data.binary_expr.op), lt->kind);
+    }
+    if (opcode == OPC_NONE) {
+        type_error(ck, node, "invalid compound assignment of %s to %s variable",
+                   type_to_string(rt, a, sizeof(a)), type_to_string(lt, b, sizeof(b)));
+        return NULL;
+    }
+    node->data.binary_expr.opcode = opcode;
+    return lt;
+}
+
+// 字面量 (包括取负的数值字面量) 的常量值
+static int const_value(const ast_node_t* node, value_t* out) {
+    int negate = 0;
+    if (node->type == AST_UNARY_EXPR && node->data.unary_expr.op == OP_MINUS) {
+        negate = 1;
+        node = node->data.unary_expr.operand;
+    }
+
+    switch (node->type) {
+        case AST_INTEGER_LITERAL:
+            *out = value_int(negate ? -(int64_t)node->data.integer_literal.value
+                                    : node->data.integer_literal.value);
+            return 1;
+        case AST_FLOAT_LITERAL:
+            *out = value_float(negate ? -node->data.float_literal.value
+                                      : node->data.float_literal.value);
+            return 1;
+        case AST_STRING_LITERAL:
+            if (negate) return 0;
+            *out = value_view(node->data.string_literal.value, node->data.string_literal.length);
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+// 元素全为字面量的数组在加载时编译为哈希集合, 否则返回 NULL
+const value_set_t* compile_const_set(memory_pool_t* pool, const ast_node_t* array) {
+    if (array->type != AST_ARRAY_LITERAL) return NULL;
+
+    int count = 0;
+    for (const ast_list_t* item = array->data.array_literal.items; item; item = item->next) {
+        count++;
+    }
+
+    memory_pool_t* scratch = create_pool(POOL_SIZE);
+    if (!scratch) return NULL;
+
+    const value_set_t* set = NULL;
+    value_t* items = palloc(scratch, sizeof(value_t) * (count + 1));
+    int n = 0;
+    for (const ast_list_t* item = array->data.array_literal.items; items && item; item = item->next) {
+        if (!const_value(item->node, &items[n++])) break;
+    }
+    if (items && n == count) {
+        set = create_value_set(pool, items, count);
+    }
+    destroy_pool(scratch);
+    return set;
+}
+
+// in 运算: 右侧为数组时测试元素, 为 map 时测试键
+static const type_t* check_in(checker_t* ck, ast_node_t* node) {
+    char a[128], b[128];
+    const type_t* lt = check_expr(ck, &node->data.binary_expr.left);
+    const type_t* rt = check_expr(ck, &node->data.binary_expr.right);
+    if (!lt || !rt) return NULL;
+
+    const type_t* want;
+    if (rt->kind == TYPE_ARRAY) {
+        want = rt->elem;
+    } else if (rt->kind == TYPE_MAP) {
+        want = rt->key;
+    } else {
+        type_error(ck, node, "right operand of in must be an array or map, got %s",
+                   type_to_string(rt, a, sizeof(a)));
+        return NULL;
+    }
+
+    if (lt->kind == TYPE_NIL || !coerce(ck, &node->data.binary_expr.left, lt, want)) {
+        type_error(ck, node, "cannot test %s for membership in %s",
+                   type_to_string(lt, a, sizeof(a)), type_to_string(rt, b, sizeof(b)));
+        return NULL;
+    }
+
+    if (rt->kind == TYPE_MAP) {
+        node->data.binary_expr.opcode = OPC_IN_MAP;
+    } else {
+        node->data.binary_expr.set = compile_const_set(ck->ctx->pool, node->data.binary_expr.right);
+        node->data.binary_expr.opcode = node->data.binary_expr.set ? OPC_IN_SET : OPC_IN_ARRAY;
+    }
+    return &type_int;
+}
+
+static const type_t* check_binary(checker_t* ck, ast_node_t* node) {
+    char a[128], b[128];
+    operator_type_t op = node->data.binary_expr.op;
+
+    if (op >= OP_ADD_ASSIGN && op <= OP_RSHIFT_ASSIGN) {
+        return check_compound_assign(ck, node);
+    }
+
+    if (op == OP_IN) {
+        return check_in(ck, node);
+    }
+
+    if (op == OP_AND || op == OP_OR) {
+        int ok = check_condition(ck, &node->data.binary_expr.left);
+        ok &= check_condition(ck, &node->data.binary_expr.right);
+        node->data.binary_expr.opcode = op == OP_AND ? OPC_AND : OPC_OR;
+        return ok ? &type_int : NULL;
+    }
+
+    const type_t* lt = check_expr(ck, &node->data.binary_expr.left);
+    const type_t* rt = check_expr(ck, &node->data.binary_expr.right);
+    if (!lt || !rt) return NULL;
+
+    int is_compare = op >= OP_EQ && op <= OP_LE;
+    type_kind_t kind;
+
+    if (lt->kind == TYPE_NIL || rt->kind == TYPE_NIL) {
+        // 与 nil 比较只判断是否存在
+        const type_t* other = lt->kind == TYPE_NIL ? rt : lt;
+        if ((op == OP_EQ || op == OP_NE) &&
+            (other->kind == TYPE_NIL || type_is_nullable(other))) {
+            node->data.binary_expr.opcode = op == OP_EQ ? OPC_NIL_EQ : OPC_NIL_NE;
+            return &type_int;
+        }
+        goto invalid;
+    }
+
+    if (type_is_numeric(lt) && type_is_numeric(rt)) {
+        kind = TYPE_INT;
+        if (lt->kind == TYPE_FLOAT || rt->kind == TYPE_FLOAT) {
+            kind = TYPE_FLOAT;
+            if (lt->kind == TYPE_INT) convert_to_float(ck, &node->data.binary_expr.left);
+            if (rt->kind == TYPE_INT) convert_to_float(ck, &node->data.binary_expr.right);
+        }
+    } else if (lt->kind == TYPE_STRING && rt->kind == TYPE_STRING) {
+        kind = TYPE_STRING;
+    } else {
+        goto invalid;
+    }
+
+    opcode_t opcode = is_compare ? compare_opcode(op, kind) : arith_opcode(op, kind);
+    if (opcode == OPC_NONE) goto invalid;
+
+    node->data.binary_expr.opcode = opcode;
+    return is_compare ? &type_int : type_of_kind(kind);
+
+invalid:
+    type_error(ck, node, "invalid operands of types %s and %s for binary operator",
+               type_to_string(lt, a, sizeof(a)), type_to_string(rt, b, sizeof(b)));
+    return NULL;
+}
+
+// 检查表达式并返回其类型, 可能改写 *pexpr (插入类型转换)
+static const type_t* check_expr(checker_t* ck, ast_node_t** pexpr) {
+    ast_node_t* expr = *pexpr;
+    const type_t* t = NULL;
+    if (!expr) return NULL;
+
+    switch (expr->type) {
+        case AST_INTEGER_LITERAL: t = &type_int; break;
+        case AST_FLOAT_LITERAL: t = &type_float; break;
+        case AST_STRING_LITERAL: t = &type_string; break;
+        case AST_IDENTIFIER: t = check_identifier(ck, expr); break;
+        case AST_ARRAY_LITERAL: t = check_array_literal(ck, expr); break;
+        case AST_MEMBER_ACCESS: t = check_member_access(ck, expr); break;
+        case AST_MAP_ACCESS: t = check_map_access(ck, expr); break;
+        case AST_FUNC_CALL: t = check_func_call(ck, expr); break;
+        case AST_UNARY_EXPR: t = check_unary(ck, expr); break;
+        case AST_BINARY_EXPR: t = check_binary(ck, expr); break;
+        default:
+            type_error(ck, expr, "statement used as an expression");
+            return NULL;
+    }
+
+    // 隐式转换可能替换了子节点, 但不会替换 expr 本身
+    expr->value_type = t;
+    return t;
+}
+
+static void check_statements(checker_t* ck, ast_list_t* stmts);
+
+static void check_block(checker_t* ck, ast_list_t* stmts, const char* name) {
+    if (!stmts) return;
+    push_scope(ck->ctx, create_scope(ck->ctx, name));
+    check_statements(ck, stmts);
+    pop_scope(ck->ctx);
+}
+
+static symbol_entry_t* declare_local(checker_t* ck, const ast_node_t* node,
+                                     const char* name, const type_t* t) {
+    char type_name[128];
+
+    for (symbol_entry_t* sym = ck->ctx->current_scope->symbols; sym; sym = sym->next) {
+        if (strcmp(sym->name, name) == 0) {
+            type_error(ck, node, "'%s' redeclared in this block", name);
+            break;
+        }
+    }
+
+    symbol_entry_t* sym = add_symbol(ck->ctx, name, type_to_string(t, type_name, sizeof(type_name)));
+    sym->value_type = t;
+    sym->slot = ck->slot_count++;
+    return sym;
+}
+
+static void check_let(checker_t* ck, ast_node_t* node) {
+    const type_t* t = check_expr(ck, &node->data.let_stmt.init);
+    symbol_entry_t* sym = declare_local(ck, node, node->data.let_stmt.name, t);
+    node->data.let_stmt.slot = sym->slot;
+    node->value_type = t;
+}
+
+static void check_assign(checker_t* ck, ast_node_t* node) {
+    char a[128], b[128];
+    const type_t* tt = check_expr(ck, &node->data.assign_stmt.target);
+    const type_t* vt = check_expr(ck, &node->data.assign_stmt.value);
+    if (!check_local_target(ck, node->data.assign_stmt.target) || !tt || !vt) return;
+
+    const char* name = node->data.assign_stmt.target->data.identifier.name;
+    if (tt->kind == TYPE_NIL && vt->kind != TYPE_NIL) {
+        type_error(ck, node, "variable '%s' was declared nil and can only hold nil", name);
+        return;
+    }
+    if (!coerce(ck, &node->data.assign_stmt.value, vt, tt)) {
+        type_error(ck, node, "cannot assign %s to %s variable '%s'",
+                   type_to_string(vt, a, sizeof(a)), type_to_string(tt, b, sizeof(b)), name);
+    }
+}
+
+static void check_for(checker_t* ck, ast_node_t* node) {
+    char name[128];
+    const type_t* rt = check_expr(ck, &node->data.for_stmt.range);
+    const type_t* it = NULL;
+
+    if (rt) {
+        switch (rt->kind) {
+            case TYPE_ARRAY: it = rt->elem; break;    // 数组元素
+            case TYPE_MAP: it = rt->key; break;       // map 的键
+            case TYPE_INT: it = &type_int; break;     // 0 .. n-1
+            default:
+                type_error(ck, node, "cannot iterate over %s",
+                           type_to_string(rt, name, sizeof(name)));
+                break;
+        }
+    }
+
+    push_scope(ck->ctx, create_scope(ck->ctx, "for"));
+    symbol_entry_t* sym = declare_local(ck, node, node->data.for_stmt.iterator, it);
+    node->data.for_stmt.slot = sym->slot;
+    check_statements(ck, node->data.for_stmt.body);
+    pop_scope(ck->ctx);
+}
+
+static void check_statements(checker_t* ck, ast_list_t* stmts) {
+    for (; stmts; stmts = stmts->next) {
+        ast_node_t* stmt = stmts->node;
+        if (!stmt) continue;
+
+        switch (stmt->type) {
+            case AST_LET_STMT:
+                check_let(ck, stmt);
+                break;
+            case AST_ASSIGN_STMT:
+                check_assign(ck, stmt);
+                break;
+            case AST_IF_STMT:
+                check_condition(ck, &stmt->data.if_stmt.condition);
+                check_block(ck, stmt->data.if_stmt.then_body, "then");
+                check_block(ck, stmt->data.if_stmt.else_body, "else");
+                break;
+            case AST_WHILE_STMT:
+                check_condition(ck, &stmt->data.while_stmt.condition);
+                check_block(ck, stmt->data.while_stmt.body, "while");
+                break;
+            case AST_FOR_STMT:
+                check_for(ck, stmt);
+                break;
+            case AST_RETURN_STMT:
+                break;
+            default:
+                check_expr(ck, &stmts->node);
+                break;
+        }
+    }
+}
+
+static void check_rule(checker_t* ck, ast_node_t* rule) {
+    ck->rule = rule;
+    ck->slot_count = 0;
+
+    push_scope(ck->ctx, create_scope(ck->ctx, rule->data.rule.name));
+    check_statements(ck, rule->data.rule.body);
+    pop_scope(ck->ctx);
+
+    rule->data.rule.slot_count = ck->slot_count;
+    ck->rule = NULL;
+}
+
+// 由 global 声明构造请求结构体类型
+static const type_t* build_global_type(checker_t* ck, ast_node_t* global) {
+    memory_pool_t* pool = ck->ctx->pool;
+    type_t* t = palloc(pool, sizeof(type_t));
+    if (!t) return NULL;
+
+    memset(t, 0, sizeof(*t));
+    t->kind = TYPE_STRUCT;
+    t->name = global->data.global.name;
+    for (ast_list_t* m = global->data.global.members; m; m = m->next) {
+        if (m->node) t->field_count++;
+    }
+    t->fields = palloc(pool, sizeof(struct_field_t) * (t->field_count + 1));
+    if (!t->fields) return NULL;
+    memset(t->fields, 0, sizeof(struct_field_t) * (t->field_count + 1));
+
+    int i = 0;
+    for (ast_list_t* m = global->data.global.members; m; m = m->next) {
+        ast_node_t* member = m->node;
+        if (!member) continue;
+
+        const char* name = member->data.struct_member.name;
+        t->field_count = i;
+        if (struct_field_index(t, name) >= 0) {
+            type_error(ck, member, "duplicate member '%s' in %s", name, t->name);
+        }
+        t->fields[i].name = name;
+        t->fields[i].type = parse_type_spec(pool, member->data.struct_member.type);
+        if (!t->fields[i].type) {
+            type_error(ck, member, "unsupported type '%s'", member->data.struct_member.type);
+        }
+        member->value_type = t->fields[i].type;
+        i++;
+    }
+    t->field_count = i;
+
+    global->value_type = t;
+    return t;
+}
+
+int check_program(parser_context_t* ctx) {
+    checker_t ck;
+    memset(&ck, 0, sizeof(ck));
+    ck.ctx = ctx;
+    if (!ctx->root) return 0;
+
+    ast_node_t* global = ctx->root->data.program.global;
+    if (global) {
+        ck.global_name = global->data.global.name;
+        ck.global_type = build_global_type(&ck, global);
+    }
+
+    for (ast_list_t* ns = ctx->root->data.program.namespaces; ns; ns = ns->next) {
+        if (!ns->node) continue;
+        for (ast_list_t* r = ns->node->data.namespace.rules; r; r = r->next) {
+            if (r->node) check_rule(&ck, r->node);
+        }
+    }
+    return ck.errors;
+}
@@ -0,0 +1,721 @@
+#include <stdio.h>
+#include <string.h>
+#include "engine.h"
+#include "ruleset.h"
+
+static int count_list(const ast_list_t* list) {
+    int n = 0;
+    for (; list; list = list->next) {
+        if (list->node) n++;
+    }
+    return n;
+}
+
+static int find_rule(const ast_node_t** rules, int n, const char* name) {
+    for (int i = 0; i < n; i++) {
+        if (strcmp(rules[i]->data.rule.name, name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// 收集 after/before 依赖边, from 必须在 to 之前执行.
+// 找不到的规则可能由覆盖合并的另一层提供, 在 check_rule_references 中报告
+static int collect_edges(const ast_node_t** rules, int n, int* from, int* to) {
+    int count = 0;
+    for (int i = 0; i < n; i++) {
+        const ast_node_t* rule = rules[i];
+        for (const ast_list_t* dep = rule->data.rule.after_rules; dep; dep = dep->next) {
+            int j = find_rule(rules, n, dep->node->data.identifier.name);
+            if (j < 0) continue;
+            from[count] = j;
+            to[count++] = i;
+        }
+        for (const ast_list_t* dep = rule->data.rule.before_rules; dep; dep = dep->next) {
+            int j = find_rule(rules, n, dep->node->data.identifier.name);
+            if (j < 0) continue;
+            from[count] = i;
+            to[count++] = j;
+        }
+    }
+    return count;
+}
+
+// 对命名空间内的规则做拓扑排序, 无依赖约束时保持声明顺序
+static int order_rules(const char* ns_name, const ast_node_t** rules, int n,
+                       compiled_rule_t* out) {
+    if (n <= 0) return 0;
+    size_t count = (size_t)n;
+
+    memory_pool_t* scratch = create_pool(POOL_SIZE);
+    if (!scratch) return -1;
+
+    size_t edge_cap = 0;
+    for (int i = 0; i < n; i++) {
+        edge_cap += count_list(rules[i]->data.rule.after_rules);
+        edge_cap += count_list(rules[i]->data.rule.before_rules);
+    }
+
+    int* from = palloc(scratch, sizeof(int) * (edge_cap + 1));
+    int* to = palloc(scratch, sizeof(int) * (edge_cap + 1));
+    int* indegree = palloc(scratch, sizeof(int) * count);
+    int* first = palloc(scratch, sizeof(int) * (count + 1));
+    int* fill = palloc(scratch, sizeof(int) * count);
+    int* adjacent = palloc(scratch, sizeof(int) * (edge_cap + 1));
+    char* emitted = palloc(scratch, count);
+    if (!from || !to || !indegree || !first || !fill || !adjacent || !emitted) {
+        destroy_pool(scratch);
+        return -1;
+    }
+    int edges = collect_edges(rules, n, from, to);
+
+    // 邻接表 (CSR)
+    memset(indegree, 0, sizeof(int) * count);
+    memset(first, 0, sizeof(int) * (count + 1));
+    memset(emitted, 0, count);
+    for (int e = 0; e < edges; e++) {
+        first[from[e] + 1]++;
+        indegree[to[e]]++;
+    }
+    for (int v = 0; v < n; v++) {
+        first[v + 1] += first[v];
+    }
+    memcpy(fill, first, sizeof(int) * count);
+    for (int e = 0; e < edges; e++) {
+        adjacent[fill[from[e]]++] = to[e];
+    }
+
+    // Kahn 算法, 每次取声明最靠前的就绪规则
+    for (int k = 0; k < n; k++) {
+        int next = -1;
+        for (int v = 0; v < n; v++) {
+            if (!emitted[v] && indegree[v] == 0) {
+                next = v;
+                break;
+            }
+        }
+        if (next < 0) {
+            // 存在环: 取声明最靠前的剩余规则打破环
+            for (int v = 0; v < n; v++) {
+                if (!emitted[v]) {
+                    next = v;
+                    break;
+                }
+            }
+            printf("Warning: circular after/before dependency at rule %s::%s, "
+                   "using declaration order\n", ns_name, rules[next]->data.rule.name);
+        }
+
+        emitted[next] = 1;
+        for (int e = first[next]; e < first[next + 1]; e++) {
+            indegree[adjacent[e]]--;
+        }
+
+        compiled_rule_t* rule = &out[k];
+        rule->name = rules[next]->data.rule.name;
+        rule->namespace_name = ns_name;
+        rule->node = rules[next];
+        rule->ordinal = k;
+    }
+
+    destroy_pool(scratch);
+    return n;
+}
+
+int compile_namespace_rules(compiled_namespace_t* ns, const ast_node_t** rules, int n,
+                            feature_table_t* features, const char* global_name) {
+    ns->rules = palloc(ns->pool, sizeof(compiled_rule_t) * (n + 1));
+    rule_filter_t* filters = palloc(ns->pool, sizeof(rule_filter_t) * (n + 1));
+    if (!ns->rules || !filters) return -1;
+    if (order_rules(ns->name, rules, n, ns->rules) < 0) return -1;
+    ns->rule_count = n;
+    ns->max_slots = 0;
+
+    for (int i = 0; i < n; i++) {
+        compiled_rule_t* rule = &ns->rules[i];
+        rule->filter = extract_rule_filter(features, ns->pool, global_name, rule->node);
+        filters[i] = rule->filter;
+        if (rule->node->data.rule.slot_count > ns->max_slots) {
+            ns->max_slots = rule->node->data.rule.slot_count;
+        }
+    }
+    return build_prefilter_index(&ns->index, ns->pool, filters, n);
+}
+
+// 覆盖合并时在 overlay 中按名字查找规则, 返回合并后的编号 base_count + i
+static int find_overlay_rule(const compiled_namespace_t* overlay, int base_count,
+                             const char* name) {
+    for (int i = 0; i < overlay->rule_count; i++) {
+        if (strcmp(overlay->rules[i].name, name) == 0) {
+            return base_count + i;
+        }
+    }
+    return -1;
+}
+
+// 覆盖合并中的规则编号: base 规则 k 为 k, overlay 规则 i 为 base_count + i.
+// 名字先在 overlay 中查找, 被替换的 base 规则由替换它的规则代替
+static int resolve_merged_rule(const compiled_namespace_t* overlay,
+                               const compiled_rule_t** base_rules, const char* replaced,
+                               int base_count, const char* name) {
+    int j = find_overlay_rule(overlay, base_count, name);
+    if (j >= 0) return j;
+    for (int k = 0; k < base_count; k++) {
+        if (!replaced[k] && strcmp(base_rules[k]->name, name) == 0) return k;
+    }
+    return -1;
+}
+
+// 收集跨越 base 与 overlay 的依赖边. base 规则之间的边已由 base 的执行顺序满足,
+// 只需要 base 规则指向 overlay 规则的边
+static int collect_merged_edges(const compiled_namespace_t* overlay,
+                                const compiled_rule_t** base_rules, const char* replaced,
+                                int base_count, int* from, int* to) {
+    int count = 0;
+    for (int v = 0; v < base_count + overlay->rule_count; v++) {
+        int is_base = v < base_count;
+        if (is_base && replaced[v]) continue;
+        const ast_node_t* rule = is_base ? base_rules[v]->node :
+                                           overlay->rules[v - base_count].node;
+
+        for (const ast_list_t* dep = rule->data.rule.after_rules; dep; dep = dep->next) {
+            const char* name = dep->node->data.identifier.name;
+            int j = is_base ? find_overlay_rule(overlay, base_count, name) :
+                              resolve_merged_rule(overlay, base_rules, replaced, base_count, name);
+            if (j < 0 || j == v) continue;
+            from[count] = j;
+            to[count++] = v;
+        }
+        for (const ast_list_t* dep = rule->data.rule.before_rules; dep; dep = dep->next) {
+            const char* name = dep->node->data.identifier.name;
+            int j = is_base ? find_overlay_rule(overlay, base_count, name) :
+                              resolve_merged_rule(overlay, base_rules, replaced, base_count, name);
+            if (j < 0 || j == v) continue;
+            from[count] = v;
+            to[count++] = j;
+        }
+    }
+    return count;
+}
+
+int compile_merged_rules(compiled_namespace_t* ns) {
+    const compiled_namespace_t* base = ns->base;
+    const compiled_namespace_t* overlay = ns->overlay;
+    int base_count = base->rule_count;
+    int overlay_count = overlay->rule_count;
+    int n = base_count + overlay_count;
+
+    memory_pool_t* scratch = create_pool(POOL_SIZE);
+    if (!scratch) return -1;
+    int result = -1;
+
+    int edge_cap = 0;
+    for (int i = 0; i < overlay_count; i++) {
+        edge_cap += count_list(overlay->rules[i].node->data.rule.after_rules);
+        edge_cap += count_list(overlay->rules[i].node->data.rule.before_rules);
+    }
+    const compiled_rule_t** base_rules = palloc(scratch, sizeof(compiled_rule_t*) *
+                                                         (base_count + 1));
+    if (!base_rules || namespace_rules(base, base_rules) != 0) goto done;
+    for (int k = 0; k < base_count; k++) {
+        edge_cap += count_list(base_rules[k]->node->data.rule.after_rules);
+        edge_cap += count_list(base_rules[k]->node->data.rule.before_rules);
+    }
+
+    char* replaced = palloc(scratch, (size_t)base_count + 1);
+    char* emitted = palloc(scratch, (size_t)overlay_count + 1);
+    int* slots = palloc(scratch, sizeof(int) * (overlay_count + 1));
+    int* anchor_of = palloc(scratch, sizeof(int) * (overlay_count + 1));
+    int* pending = palloc(scratch, sizeof(int) * (overlay_count + 1));
+    int* from = palloc(scratch, sizeof(int) * (edge_cap + 1));
+    int* to = palloc(scratch, sizeof(int) * (edge_cap + 1));
+    int* adjacent = palloc(scratch, sizeof(int) * (edge_cap + 1));
+    int* indegree = palloc(scratch, sizeof(int) * (n + 1));
+    int* first = palloc(scratch, sizeof(int) * (n + 1));
+    int* fill = palloc(scratch, sizeof(int) * (n + 1));
+    ns->replaced = palloc(ns->pool, sizeof(int) * (overlay_count + 1));
+    ns->positions = palloc(ns->pool, sizeof(int) * (overlay_count + 1));
+    ns->by_position = palloc(ns->pool, sizeof(int) * (overlay_count + 1));
+    ns->ranks = palloc(ns->pool, sizeof(int) * (overlay_count + 1));
+    ns->anchors = palloc(ns->pool, sizeof(int) * (overlay_count + 1));
+    if (!replaced || !emitted || !slots || !anchor_of || !pending || !from || !to ||
+        !adjacent || !indegree || !first || !fill || !ns->replaced || !ns->positions ||
+        !ns->by_position || !ns->ranks || !ns->anchors) {
+        goto done;
+    }
+
+    // overlay 中与 base 同名的规则替换 base 的规则, 无约束时占据它的位置
+    memset(replaced, 0, (size_t)base_count + 1);
+    memset(emitted, 0, (size_t)overlay_count + 1);
+    for (int i = 0; i < overlay_count; i++) {
+        slots[i] = -1;
+        for (int k = 0; k < base_count; k++) {
+            if (strcmp(base_rules[k]->name, overlay->rules[i].name) == 0) {
+                slots[i] = k;
+                replaced[k] = 1;
+                break;
+            }
+        }
+    }
+    ns->replaced_count = 0;
+    for (int k = 0; k < base_count; k++) {
+        if (replaced[k]) ns->replaced[ns->replaced_count++] = k;
+    }
+
+    int edges = collect_merged_edges(overlay, base_rules, replaced, base_count, from, to);
+    memset(indegree, 0, sizeof(int) * (n + 1));
+    memset(first, 0, sizeof(int) * (n + 1));
+    for (int e = 0; e < edges; e++) {
+        first[from[e] + 1]++;
+        indegree[to[e]]++;
+    }
+    for (int v = 0; v < n; v++) {
+        first[v + 1] += first[v];
+    }
+    memcpy(fill, first, sizeof(int) * (n + 1));
+    for (int e = 0; e < edges; e++) {
+        adjacent[fill[from[e]]++] = to[e];
+    }
+
+    // Kahn 算法. base 规则只能按原顺序逐个取出, 每次在下一个 base 规则和
+    // 就绪的 overlay 规则中取默认位置最靠前的: 替换规则为被替换的位置, 新规则排在 base 之后
+    int total = n - ns->replaced_count;
+    int head = 0;
+    while (head < base_count && replaced[head]) head++;
+    int pending_count = 0;
+    for (int t = 0; t < total; t++) {
+        int next = -1, best = n;
+        for (int pass = 0; pass < 2 && next < 0; pass++) {
+            // 第二遍忽略入度: 存在环时取默认位置最靠前的剩余规则打破环
+            if (head < base_count && (pass || indegree[head] == 0)) {
+                next = head;
+                best = head;
+            }
+            for (int i = 0; i < overlay_count; i++) {
+                if (emitted[i] || (!pass && indegree[base_count + i] > 0)) continue;
+                int key = slots[i] >= 0 ? slots[i] : base_count + i;
+                if (key < best) {
+                    next = base_count + i;
+                    best = key;
+                }
+            }
+            if (pass && next >= 0) {
+                printf("Warning: circular after/before dependency at rule %s::%s, "
+                       "using declaration order\n", ns->name,
+                       next < base_count ? base_rules[next]->name :
+                                           overlay->rules[next - base_count].name);
+            }
+        }
+
+        for (int e = first[next]; e < first[next + 1]; e++) {
+            indegree[adjacent[e]]--;
+        }
+        if (next < base_count) {
+            for (int j = 0; j < pending_count; j++) {
+                anchor_of[pending[j]] = next;
+            }
+            pending_count = 0;
+            head++;
+            while (head < base_count && replaced[head]) head++;
+        } else {
+            int i = next - base_count;
+            emitted[i] = 1;
+            ns->positions[i] = t;
+            pending[pending_count++] = i;
+        }
+    }
+    for (int j = 0; j < pending_count; j++) {
+        anchor_of[pending[j]] = base_count;
+    }
+
+    // overlay 规则按位置排序, 选择时据此把候选规则排成执行顺序
+    for (int i = 0; i < overlay_count; i++) {
+        int r = i;
+        while (r > 0 && ns->positions[ns->by_position[r - 1]] > ns->positions[i]) {
+            ns->by_position[r] = ns->by_position[r - 1];
+            r--;
+        }
+        ns->by_position[r] = i;
+    }
+    for (int r = 0; r < overlay_count; r++) {
+        ns->ranks[ns->by_position[r]] = r;
+        ns->anchors[r] = anchor_of[ns->by_position[r]];
+    }
+
+    ns->rule_count = total;
+    result = 0;
+
+done:
+    destroy_pool(scratch);
+    return result;
+}
+
+// base 中未被替换的规则 p 合并后的位置: 减去 p 之前被替换的规则, 加上插在 p 之前的
+// overlay 规则. p 按升序给出时 replaced 和 anchors 的游标只前进
+static int merged_position(const compiled_namespace_t* ns, int p, int* ri, int* ai) {
+    while (*ri < ns->replaced_count && ns->replaced[*ri] < p) (*ri)++;
+    if (*ri < ns->replaced_count && ns->replaced[*ri] == p) return -1;
+    while (*ai < ns->overlay->rule_count && ns->anchors[*ai] <= p) (*ai)++;
+    return p - *ri + *ai;
+}
+
+int namespace_rules(const compiled_namespace_t* ns, const compiled_rule_t** out) {
+    if (!ns->base) {
+        for (int i = 0; i < ns->rule_count; i++) {
+            out[i] = &ns->rules[i];
+        }
+        return 0;
+    }
+
+    int base_count = ns->base->rule_count;
+    const compiled_rule_t** base_rules = malloc(sizeof(compiled_rule_t*) * (base_count + 1));
+    if (!base_rules || namespace_rules(ns->base, base_rules) != 0) {
+        free(base_rules);
+        return -1;
+    }
+    int ri = 0, ai = 0;
+    for (int p = 0; p < base_count; p++) {
+        int position = merged_position(ns, p, &ri, &ai);
+        if (position >= 0) out[position] = base_rules[p];
+    }
+    free(base_rules);
+
+    for (int i = 0; i < ns->overlay->rule_count; i++) {
+        out[ns->positions[i]] = &ns->overlay->rules[i];
+    }
+    return 0;
+}
+
+static int compare_rule_names(const void* a, const void* b) {
+    return strcmp((*(const compiled_rule_t* const*)a)->name,
+                  (*(const compiled_rule_t* const*)b)->name);
+}
+
+static int has_rule(const compiled_rule_t** sorted, int n, const char* name) {
+    compiled_rule_t key;
+    const compiled_rule_t* p = &key;
+    key.name = name;
+    return bsearch(&p, sorted, n, sizeof(compiled_rule_t*), compare_rule_names) != NULL;
+}
+
+void check_rule_references(const compiled_namespace_t* ns) {
+    const compiled_rule_t** rules = malloc(sizeof(compiled_rule_t*) * (ns->rule_count + 1));
+    if (!rules || namespace_rules(ns, rules) != 0) {
+        free(rules);
+        return;
+    }
+    qsort(rules, ns->rule_count, sizeof(compiled_rule_t*), compare_rule_names);
+
+    for (int i = 0; i < ns->rule_count; i++) {
+        const ast_node_t* rule = rules[i]->node;
+        for (const ast_list_t* dep = rule->data.rule.after_rules; dep; dep = dep->next) {
+            if (!has_rule(rules, ns->rule_count, dep->node->data.identifier.name)) {
+                printf("Warning: rule %s::%s runs after unknown rule %s\n",
+                       ns->name, rules[i]->name, dep->node->data.identifier.name);
+            }
+        }
+        for (const ast_list_t* dep = rule->data.rule.before_rules; dep; dep = dep->next) {
+            if (!has_rule(rules, ns->rule_count, dep->node->data.identifier.name)) {
+                printf("Warning: rule %s::%s runs before unknown rule %s\n",
+                       ns->name, rules[i]->name, dep->node->data.identifier.name);
+            }
+        }
+    }
+    free(rules);
+}
+
+rule_engine_t* create_rule_engine_from(compiled_namespace_t** namespaces, int count,
+                                       const feature_table_t* features) {
+    // 引擎本身很小, 按实际大小分配, 租户数量多时不浪费整块内存池
+    const type_t* global_type = NULL;
+    for (int i = 0; i < count && !global_type; i++) {
+        global_type = namespaces[i]->global_type;
+    }
+    int field_count = global_type ? global_type->field_count : 0;
+    size_t size = sizeof(rule_engine_t) + CACHE_LINE_SIZE +
+                  sizeof(compiled_namespace_t*) * (count + 1) + sizeof(int) * (field_count + 1) + 64;
+    memory_pool_t* pool = create_pool(size);
+    if (!pool) return NULL;
+
+    rule_engine_t* engine = palloc_aligned(pool, sizeof(rule_engine_t), _Alignof(rule_engine_t));
+    if (!engine) {
+        destroy_pool(pool);
+        return NULL;
+    }
+    memset(engine, 0, sizeof(*engine));
+    engine->pool = pool;
+    engine->features = features;
+    engine->namespaces = palloc(pool, sizeof(compiled_namespace_t*) * (count + 1));
+    if (!engine->namespaces) {
+        destroy_rule_engine(engine);
+        return NULL;
+    }
+
+    for (int i = 0; i < count; i++) {
+        compiled_namespace_t* ns = namespaces[i];
+        engine->namespaces[engine->namespace_count++] = ns;
+        engine->rule_count += ns->rule_count;
+        if (ns->rule_count > engine->max_namespace_rules) {
+            engine->max_namespace_rules = ns->rule_count;
+        }
+        if (ns->max_slots > engine->max_slots) {
+            engine->max_slots = ns->max_slots;
+        }
+    }
+    engine->global_type = global_type;
+    engine->global_name = global_type ? global_type->name : NULL;
+
+    engine->field_features = palloc(pool, sizeof(int) * (field_count + 1));
+    if (!engine->field_features) {
+        destroy_rule_engine(engine);
+        return NULL;
+    }
+    for (int i = 0; i < field_count; i++) {
+        engine->field_features[i] = lookup_feature(features, FEATURE_FIELD,
+                                                    global_type->fields[i].name, NULL, 0);
+    }
+    return engine;
+}
+
+rule_engine_t* create_rule_engine(parser_context_t* ctx) {
+    if (!ctx->root) return NULL;
+
+    ruleset_registry_t* registry = create_ruleset_registry();
+    if (!registry) return NULL;
+
+    int count = 0;
+    compiled_namespace_t** namespaces = registry_add_program(registry, ctx, &count);
+    rule_engine_t* engine = NULL;
+    if (namespaces) {
+        // 私有注册表之后不再加载, 直接使用它的特征表
+        engine = create_rule_engine_from(namespaces, count, &registry->features);
+        free(namespaces);
+    }
+    if (!engine) {
+        destroy_ruleset_registry(registry);
+        return NULL;
+    }
+    engine->owned_registry = registry;
+    return engine;
+}
+
+void destroy_rule_engine(rule_engine_t* engine) {
+    if (engine) {
+        ruleset_registry_t* registry = engine->owned_registry;
+        destroy_pool(engine->pool);
+        destroy_ruleset_registry(registry);
+    }
+}
+
+int engine_feature_id(const rule_engine_t* engine, feature_kind_t kind,
+                      const char* member, const char* key, size_t key_len) {
+    return lookup_feature(engine->features, kind, member, key, key_len);
+}
+
+rule_selection_t* create_rule_selection(memory_pool_t* pool, const rule_engine_t* engine) {
+    rule_selection_t* selection = palloc(pool, sizeof(rule_selection_t));
+    if (!selection) return NULL;
+
+    int words = (engine->max_namespace_rules + 63) / 64 + 1;
+    selection->scratch = palloc(pool, sizeof(uint64_t) * words);
+    selection->ordinals = palloc(pool, sizeof(int) * (engine->max_namespace_rules + 1));
+    selection->positions = palloc(pool, sizeof(int) * (engine->max_namespace_rules + 1));
+    selection->rules = palloc(pool, sizeof(compiled_rule_t*) * (engine->rule_count + 1));
+    selection->count = 0;
+    if (!selection->scratch || !selection->ordinals || !selection->positions ||
+        !selection->rules) {
+        return NULL;
+    }
+
+    memset(selection->scratch, 0, sizeof(uint64_t) * words);
+    return selection;
+}
+
+// 成员是否视为存在: nil 和数值 0 都与缺失等价
+static int value_present(const value_t* v) {
+    switch (v->tag) {
+        case VALUE_NIL: return 0;
+        case VALUE_INT: return v->i.value != 0;
+        case VALUE_FLOAT: return v->f.value != 0.0;
+        default: return 1;
+    }
+}
+
+static void set_feature(presence_set_t* present, int id) {
+    if (id >= 0) presence_set_add(present, id);
+}
+
+// 根据请求内容填写存在位图, 只查找特征表, 不分配内存
+void engine_fill_presence(const rule_engine_t* engine, const request_t* request,
+                          presence_set_t* present) {
+    presence_set_clear(present);
+
+    int field_count = engine->global_type ? engine->global_type->field_count : 0;
+    for (int i = 0; i < field_count; i++) {
+        const value_t* v = &request->fields[i];
+        if (!value_present(v)) continue;
+        set_feature(present, engine->field_features[i]);
+
+        if (v->tag != VALUE_MAP) continue;
+        const char* member = engine->global_type->fields[i].name;
+        const value_map_t* map = v->map.ptr;
+        for (int k = 0; k < map->count; k++) {
+            const value_t* key = &map->keys[k];
+            if (!value_is_string(key)) continue;
+            set_feature(present, lookup_feature(engine->features, FEATURE_FIELD, member,
+                                                 value_str_data(key), value_str_len(key)));
+        }
+    }
+
+    if (request->keywords) {
+        const value_map_t* keywords = request->keywords;
+        for (int k = 0; k < keywords->count; k++) {
+            const value_t* key = &keywords->keys[k];
+            if (!value_is_string(key)) continue;
+            set_feature(present, lookup_feature(engine->features, FEATURE_KEYWORD, NULL,
+                                                 value_str_data(key), value_str_len(key)));
+        }
+    }
+}
+
+// 选出一个命名空间的候选规则, 按执行顺序写入 rules, 执行顺序写入 positions
+static int select_namespace(const compiled_namespace_t* ns, const presence_set_t* present,
+                            rule_selection_t* selection, const compiled_rule_t** rules) {
+    int* positions = selection->positions;
+    int* ordinals = selection->ordinals;
+
+    if (!ns->base) {
+        int n = prefilter_select(&ns->index, present, selection->scratch, ordinals);
+        for (int k = 0; k < n; k++) {
+            rules[k] = &ns->rules[ordinals[k]];
+            positions[k] = ordinals[k];
+        }
+        return n;
+    }
+
+    // base 的候选中去掉被替换的规则, 位置换算为合并后的位置
+    int n = select_namespace(ns->base, present, selection, rules);
+    int m = 0, ri = 0, ai = 0;
+    for (int k = 0; k < n; k++) {
+        int position = merged_position(ns, positions[k], &ri, &ai);
+        if (position < 0) continue;
+        rules[m] = rules[k];
+        positions[m++] = position;
+    }
+
+    // overlay 的候选按执行顺序重排: 借用 scratch 按 rank 置位再顺序取出
+    const compiled_namespace_t* overlay = ns->overlay;
+    int c = prefilter_select(&overlay->index, present, selection->scratch, ordinals);
+    uint64_t* scratch = selection->scratch;
+    for (int k = 0; k < c; k++) {
+        int r = ns->ranks[ordinals[k]];
+        scratch[r >> 6] |= 1ULL << (r & 63);
+    }
+    c = 0;
+    for (int w = 0; w < overlay->index.word_count; w++) {
+        uint64_t bits = scratch[w];
+        scratch[w] = 0;
+        while (bits) {
+            ordinals[c++] = ns->by_position[w * 64 + __builtin_ctzll(bits)];
+            bits &= bits - 1;
+        }
+    }
+
+    // 从后向前归并, 两侧的位置互不相同
+    int i = m - 1, j = c - 1;
+    for (int out = m + c - 1; j >= 0; out--) {
+        int pj = ns->positions[ordinals[j]];
+        if (i >= 0 && positions[i] > pj) {
+            rules[out] = rules[i];
+            positions[out] = positions[i--];
+        } else {
+            rules[out] = &overlay->rules[ordinals[j]];
+            positions[out] = pj;
+            j--;
+        }
+    }
+    return m + c;
+}
+
+// 选出本次请求需要执行的规则, 代价与相关规则数成正比
+int engine_select_rules(const rule_engine_t* engine, const presence_set_t* present,
+                        rule_selection_t* selection) {
+    selection->count = 0;
+    for (int i = 0; i < engine->namespace_count; i++) {
+        selection->count += select_namespace(engine->namespaces[i], present, selection,
+                                             selection->rules + selection->count);
+    }
+    return selection->count;
+}
+
+static const feature_entry_t* find_feature_entry(const feature_table_t* table, int id) {
+    for (int b = 0; b < FEATURE_BUCKETS; b++) {
+        for (const feature_entry_t* e = table->buckets[b]; e; e = e->next) {
+            if (e->id == id) return e;
+        }
+    }
+    return NULL;
+}
+
+// 特征键可能包含 \0 等不可打印字符, 按转义形式输出
+static void print_key(const feature_entry_t* e) {
+    for (size_t i = 0; i < e->key_len; i++) {
+        unsigned char c = (unsigned char)e->key[i];
+        if (c >= 0x20 && c < 0x7f && c != '\'' && c != '\\') {
+            putchar(c);
+        } else {
+            printf("\\x%02x", c);
+        }
+    }
+}
+
+static void print_rule(const rule_engine_t* engine, const compiled_rule_t* rule, int position) {
+    printf("  %d. %s::%s  requires: ", position, rule->namespace_name, rule->name);
+
+    if (rule->filter.always) {
+        printf("(always)\n");
+        return;
+    }
+    if (rule->filter.count == 0) {
+        printf("(never, only continues)\n");
+        return;
+    }
+    for (int f = 0; f < rule->filter.count; f++) {
+        const feature_entry_t* e = find_feature_entry(engine->features,
+                                                      rule->filter.features[f]);
+        if (f > 0) printf(" | ");
+        if (!e) {
+            printf("#%d", rule->filter.features[f]);
+        } else if (e->kind == FEATURE_KEYWORD) {
+            printf("keyword '");
+            print_key(e);
+            printf("'");
+        } else if (e->key) {
+            printf("%s.%s['", engine->global_name, e->member);
+            print_key(e);
+            printf("']");
+        } else {
+            printf("%s.%s", engine->global_name, e->member);
+        }
+    }
+    printf("\n");
+}
+
+void print_rule_engine(const rule_engine_t* engine) {
+    printf("Rule order (%d rules, %d features):\n", engine->rule_count,
+           engine->features->count);
+    const compiled_rule_t** rules = malloc(sizeof(compiled_rule_t*) *
+                                           (engine->max_namespace_rules + 1));
+    if (!rules) return;
+
+    int position = 0;
+    for (int i = 0; i < engine->namespace_count; i++) {
+        const compiled_namespace_t* ns = engine->namespaces[i];
+        if (namespace_rules(ns, rules) != 0) break;
+        for (int r = 0; r < ns->rule_count; r++) {
+            print_rule(engine, rules[r], ++position);
+        }
+    }
+    free(rules);
+}
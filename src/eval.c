@@ -0,0 +1,645 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include "eval.h"
+#include "types.h"
+
+// 语句执行结果
+typedef enum {
+    EXEC_NEXT,
+    EXEC_RETURN,
+    EXEC_ERROR,
+    EXEC_PENDING     // 等待异步查询
+} exec_status_t;
+
+static void runtime_error(eval_context_t* ec, const ast_node_t* node, const char* fmt, ...) {
+    va_list args;
+
+    if (ec->halted) return;
+    ec->halted = 1;
+
+    fprintf(stderr, "Runtime error at line %d", node ? node->line : 0);
+    if (ec->rule) {
+        fprintf(stderr, " in rule %s::%s", ec->rule->namespace_name, ec->rule->name);
+    }
+    fprintf(stderr, ": ");
+    va_start(args, fmt);
+    vfprintf(stderr, fmt, args);
+    va_end(args);
+    fprintf(stderr, "\n");
+}
+
+eval_context_t* create_eval_context(const rule_engine_t* engine) {
+    memory_pool_t* pool = create_pool(POOL_SIZE);
+    if (!pool) return NULL;
+
+    eval_context_t* ec = palloc_aligned(pool, sizeof(eval_context_t), _Alignof(eval_context_t));
+    if (!ec) {
+        destroy_pool(pool);
+        return NULL;
+    }
+    memset(ec, 0, sizeof(*ec));
+    ec->engine = engine;
+    ec->pool = pool;
+    ec->slots = palloc_aligned(pool, sizeof(value_t) * (engine->max_slots + 1), CACHE_LINE_SIZE);
+    ec->presence = create_presence_set(pool, engine->features->count);
+    ec->selection = create_rule_selection(pool, engine);
+    if (!ec->slots || !ec->presence || !ec->selection) {
+        destroy_eval_context(ec);
+        return NULL;
+    }
+    return ec;
+}
+
+void destroy_eval_context(eval_context_t* ctx) {
+    if (ctx) {
+        destroy_pool(ctx->pool);
+    }
+}
+
+void eval_set_sidecar(eval_context_t* ctx, sidecar_t* sidecar) {
+    ctx->sidecar = sidecar;
+}
+
+static exec_status_t halt_status(const eval_context_t* ec) {
+    return ec->suspended ? EXEC_PENDING : EXEC_ERROR;
+}
+
+static value_t eval_expr(eval_context_t* ec, const ast_node_t* node);
+
+// 整数运算按补码回绕, 避免有符号溢出
+static int64_t wrap_add(int64_t a, int64_t b) { return (int64_t)((uint64_t)a + (uint64_t)b); }
+static int64_t wrap_sub(int64_t a, int64_t b) { return (int64_t)((uint64_t)a - (uint64_t)b); }
+static int64_t wrap_mul(int64_t a, int64_t b) { return (int64_t)((uint64_t)a * (uint64_t)b); }
+
+// 字符串相等: nil 只与 nil 相等
+static int str_equal(const value_t* a, const value_t* b) {
+    if (value_is_nil(a) || value_is_nil(b)) {
+        return value_is_nil(a) && value_is_nil(b);
+    }
+    return value_str_len(a) == value_str_len(b) && value_str_compare(a, b) == 0;
+}
+
+// 字符串大小比较, 任一侧为 nil 时不成立
+static int str_order(const value_t* a, const value_t* b, int* cmp) {
+    if (value_is_nil(a) || value_is_nil(b)) return 0;
+    *cmp = value_str_compare(a, b);
+    return 1;
+}
+
+// 非常量数组的成员测试, 逐个比较
+static int array_contains(const value_t* array, const value_t* v) {
+    if (array->tag != VALUE_ARRAY) return 0;
+    for (int i = 0; i < array->array.ptr->count; i++) {
+        if (value_key_equal(&array->array.ptr->items[i], v)) return 1;
+    }
+    return 0;
+}
+
+// 按类型检查选定的操作码计算二元运算, 不再检查操作数类型
+static value_t apply_binary(eval_context_t* ec, const ast_node_t* node, opcode_t opcode,
+                            const value_t* a, const value_t* b) {
+    int cmp = 0;
+
+    switch (opcode) {
+        case OPC_INT_ADD: return value_int(wrap_add(a->i.value, b->i.value));
+        case OPC_INT_SUB: return value_int(wrap_sub(a->i.value, b->i.value));
+        case OPC_INT_MUL: return value_int(wrap_mul(a->i.value, b->i.value));
+        case OPC_INT_DIV:
+        case OPC_INT_MOD:
+            if (b->i.value == 0) {
+                runtime_error(ec, node, "integer division by zero");
+                return value_int(0);
+            }
+            if (b->i.value == -1) {
+                return value_int(opcode == OPC_INT_DIV ? wrap_sub(0, a->i.value) : 0);
+            }
+            return value_int(opcode == OPC_INT_DIV ? a->i.value / b->i.value
+                                                   : a->i.value % b->i.value);
+        case OPC_INT_BAND: return value_int(a->i.value & b->i.value);
+        case OPC_INT_BOR: return value_int(a->i.value | b->i.value);
+        case OPC_INT_BXOR: return value_int(a->i.value ^ b->i.value);
+        case OPC_INT_LSHIFT:
+        case OPC_INT_RSHIFT:
+            if (b->i.value < 0 || b->i.value >= 64) {
+                runtime_error(ec, node, "shift count %lld out of range", (long long)b->i.value);
+                return value_int(0);
+            }
+            if (opcode == OPC_INT_LSHIFT) {
+                return value_int((int64_t)((uint64_t)a->i.value << b->i.value));
+            }
+            return value_int(a->i.value >> b->i.value);
+        case OPC_INT_EQ: return value_int(a->i.value == b->i.value);
+        case OPC_INT_NE: return value_int(a->i.value != b->i.value);
+        case OPC_INT_GT: return value_int(a->i.value > b->i.value);
+        case OPC_INT_LT: return value_int(a->i.value < b->i.value);
+        case OPC_INT_GE: return value_int(a->i.value >= b->i.value);
+        case OPC_INT_LE: return value_int(a->i.value <= b->i.value);
+
+        case OPC_FLOAT_ADD: return value_float(a->f.value + b->f.value);
+        case OPC_FLOAT_SUB: return value_float(a->f.value - b->f.value);
+        case OPC_FLOAT_MUL: return value_float(a->f.value * b->f.value);
+        case OPC_FLOAT_DIV: return value_float(a->f.value / b->f.value);
+        case OPC_FLOAT_EQ: return value_int(a->f.value == b->f.value);
+        case OPC_FLOAT_NE: return value_int(a->f.value != b->f.value);
+        case OPC_FLOAT_GT: return value_int(a->f.value > b->f.value);
+        case OPC_FLOAT_LT: return value_int(a->f.value < b->f.value);
+        case OPC_FLOAT_GE: return value_int(a->f.value >= b->f.value);
+        case OPC_FLOAT_LE: return value_int(a->f.value <= b->f.value);
+
+        case OPC_STR_CONCAT: return value_concat(ec->request->arena, a, b);
+        case OPC_STR_EQ: return value_int(str_equal(a, b));
+        case OPC_STR_NE: return value_int(!str_equal(a, b));
+        case OPC_STR_GT: return value_int(str_order(a, b, &cmp) && cmp > 0);
+        case OPC_STR_LT: return value_int(str_order(a, b, &cmp) && cmp < 0);
+        case OPC_STR_GE: return value_int(str_order(a, b, &cmp) && cmp >= 0);
+        case OPC_STR_LE: return value_int(str_order(a, b, &cmp) && cmp <= 0);
+
+        case OPC_NIL_EQ: return value_int(value_is_nil(a) == value_is_nil(b));
+        case OPC_NIL_NE: return value_int(value_is_nil(a) != value_is_nil(b));
+
+        case OPC_IN_ARRAY: return value_int(array_contains(b, a));
+        case OPC_IN_MAP:
+            return value_int(b->tag == VALUE_MAP && !value_is_nil(a) &&
+                             value_map_get(b->map.ptr, a) != NULL);
+
+        default:
+            runtime_error(ec, node, "binary expression was not type checked");
+            return value_nil();
+    }
+}
+
+static value_t eval_binary(eval_context_t* ec, const ast_node_t* node) {
+    opcode_t opcode = node->data.binary_expr.opcode;
+    const ast_node_t* left = node->data.binary_expr.left;
+    const ast_node_t* right = node->data.binary_expr.right;
+
+    // 逻辑运算短路求值, 操作数已被规约为 int
+    if (opcode == OPC_AND) {
+        if (!eval_expr(ec, left).i.value) return value_int(0);
+        return value_int(eval_expr(ec, right).i.value != 0);
+    }
+    if (opcode == OPC_OR) {
+        if (eval_expr(ec, left).i.value) return value_int(1);
+        return value_int(eval_expr(ec, right).i.value != 0);
+    }
+
+    // 常量集合在加载时已构建, 右侧数组字面量无需求值
+    if (opcode == OPC_IN_SET) {
+        value_t v = eval_expr(ec, left);
+        return value_int(value_set_contains(node->data.binary_expr.set, &v));
+    }
+
+    value_t b = eval_expr(ec, right);
+    operator_type_t op = node->data.binary_expr.op;
+    if (op >= OP_ADD_ASSIGN && op <= OP_RSHIFT_ASSIGN) {
+        // 复合赋值, 目标一定是局部变量
+        value_t* slot = &ec->slots[left->data.identifier.slot];
+        value_t a = *slot;
+        *slot = apply_binary(ec, node, opcode, &a, &b);
+        return *slot;
+    }
+
+    value_t a = eval_expr(ec, left);
+    return apply_binary(ec, node, opcode, &a, &b);
+}
+
+static value_t eval_unary(eval_context_t* ec, const ast_node_t* node) {
+    const ast_node_t* operand = node->data.unary_expr.operand;
+    opcode_t opcode = node->data.unary_expr.opcode;
+
+    // 自增自减, 操作数一定是局部变量, 返回旧值
+    if (opcode == OPC_INT_INC || opcode == OPC_INT_DEC ||
+        opcode == OPC_FLOAT_INC || opcode == OPC_FLOAT_DEC) {
+        value_t* slot = &ec->slots[operand->data.identifier.slot];
+        value_t old = *slot;
+        switch (opcode) {
+            case OPC_INT_INC: *slot = value_int(wrap_add(old.i.value, 1)); break;
+            case OPC_INT_DEC: *slot = value_int(wrap_sub(old.i.value, 1)); break;
+            case OPC_FLOAT_INC: *slot = value_float(old.f.value + 1.0); break;
+            default: *slot = value_float(old.f.value - 1.0); break;
+        }
+        return old;
+    }
+
+    value_t v = eval_expr(ec, operand);
+    switch (opcode) {
+        case OPC_INT_NEG: return value_int(wrap_sub(0, v.i.value));
+        case OPC_INT_NOT: return value_int(!v.i.value);
+        case OPC_INT_TO_FLOAT: return value_float((double)v.i.value);
+        case OPC_FLOAT_NEG: return value_float(-v.f.value);
+        default:
+            runtime_error(ec, node, "unary expression was not type checked");
+            return value_nil();
+    }
+}
+
+// map 或数组取值, 取值方式由类型检查确定; 目标为 nil 或键不存在时返回元素类型的零值
+static value_t eval_index(eval_context_t* ec, const ast_node_t* node) {
+    value_t target = eval_expr(ec, node->data.map_access.target);
+    value_t key = eval_expr(ec, node->data.map_access.key);
+    if (value_is_nil(&target)) return value_zero(node->value_type);
+
+    switch (node->data.map_access.opcode) {
+        case OPC_INDEX_MAP: {
+            const value_t* v = value_map_get(target.map.ptr, &key);
+            if (v) return *v;
+            break;
+        }
+        case OPC_INDEX_ARRAY: {
+            const value_array_t* array = target.array.ptr;
+            if (key.i.value >= 0 && key.i.value < array->count) {
+                return array->items[key.i.value];
+            }
+            break;
+        }
+        default:
+            runtime_error(ec, node, "index expression was not type checked");
+            return value_nil();
+    }
+    return value_zero(node->value_type);
+}
+
+static value_t eval_member(eval_context_t* ec, const ast_node_t* node) {
+    value_t target = eval_expr(ec, node->data.member_access.target);
+    if (target.tag != VALUE_STRUCT) return value_nil();
+
+    const request_t* request = target.object.ptr;
+    return request->fields[node->data.member_access.field];
+}
+
+// 数组字面量的元素存放在请求 arena 中
+static value_t eval_array_literal(eval_context_t* ec, const ast_node_t* node) {
+    int count = 0;
+    for (const ast_list_t* item = node->data.array_literal.items; item; item = item->next) {
+        count++;
+    }
+
+    value_array_t* array = create_value_array(ec->request->arena, count);
+    if (!array) {
+        runtime_error(ec, node, "out of memory");
+        return value_nil();
+    }
+    int i = 0;
+    for (const ast_list_t* item = node->data.array_literal.items; item; item = item->next) {
+        array->items[i++] = eval_expr(ec, item->node);
+    }
+    return value_from_array(array);
+}
+
+// 查找本请求中相同的查询
+static lookup_t* find_lookup(eval_task_t* task, lookup_kind_t kind, const value_t* key) {
+    for (int i = 0; i < task->lookup_count; i++) {
+        lookup_t* lookup = &task->lookups[i];
+        if (lookup->kind == kind && value_key_equal(&lookup->key, key)) return lookup;
+    }
+    return NULL;
+}
+
+// 登记一个新查询
+static lookup_t* add_lookup(eval_context_t* ec, lookup_kind_t kind, const value_t* key) {
+    eval_task_t* task = ec->task;
+
+    // 只在求值期间扩容, 此时没有批次在 sidecar 中等待
+    if (task->lookup_count == task->lookup_capacity) {
+        int capacity = task->lookup_capacity ? task->lookup_capacity * 2 : 8;
+        lookup_t* lookups = palloc(task->request->arena, sizeof(lookup_t) * capacity);
+        if (!lookups) return NULL;
+        if (task->lookup_count) {
+            memcpy(lookups, task->lookups, sizeof(lookup_t) * task->lookup_count);
+        }
+        task->lookups = lookups;
+        task->lookup_capacity = capacity;
+    }
+
+    lookup_t* lookup = &task->lookups[task->lookup_count++];
+    lookup->kind = kind;
+    lookup->state = LOOKUP_PENDING;
+    lookup->key = *key;
+    lookup->result = 0;
+    ec->stats.lookups++;
+    return lookup;
+}
+
+// 异步查询: 已完成则返回结果, 否则登记查询并挂起当前规则
+static value_t eval_lookup(eval_context_t* ec, const ast_node_t* node, lookup_kind_t kind) {
+    value_t key = eval_expr(ec, node->data.func_call.args->node);
+    if (ec->halted || !value_is_string(&key)) return value_int(0);
+
+    lookup_t* lookup = find_lookup(ec->task, kind, &key);
+    if (!lookup && kind == LOOKUP_RATE_COUNT && ec->speculative) {
+        // 计数有副作用, 提前执行时不发出, 等前面的规则有了结果再重放
+        ec->halted = 1;
+        ec->suspended = 1;
+        return value_int(0);
+    }
+    if (!lookup) lookup = add_lookup(ec, kind, &key);
+    if (!lookup) {
+        runtime_error(ec, node, "out of memory");
+        return value_int(0);
+    }
+
+    switch (lookup->state) {
+        case LOOKUP_DONE:
+            return value_int(lookup->result);
+        case LOOKUP_FAILED:
+            return value_int(0);
+        default:
+            ec->halted = 1;
+            ec->suspended = 1;
+            return value_int(0);
+    }
+}
+
+static value_t eval_builtin(eval_context_t* ec, const ast_node_t* node) {
+    const ast_list_t* args = node->data.func_call.args;
+    const value_map_t* keywords = ec->request->keywords;
+
+    switch ((builtin_id_t)node->data.func_call.builtin) {
+        case BUILTIN_MATCH_KEYWORD: {
+            value_t name = eval_expr(ec, args->node);
+            return value_int(keywords && !value_is_nil(&name) &&
+                             value_map_get(keywords, &name) != NULL);
+        }
+        case BUILTIN_MATCH_KEYWORD_VALUE: {
+            value_t name = eval_expr(ec, args->node);
+            value_t want = eval_expr(ec, args->next->node);
+            if (!keywords || value_is_nil(&name)) return value_int(0);
+
+            const value_t* v = value_map_get(keywords, &name);
+            return value_int(v && value_is_string(v) && !value_is_nil(&want) &&
+                             str_equal(v, &want));
+        }
+        case BUILTIN_IP_REPUTATION:
+            return eval_lookup(ec, node, LOOKUP_IP_REPUTATION);
+        case BUILTIN_RATE_COUNT:
+            return eval_lookup(ec, node, LOOKUP_RATE_COUNT);
+        default:
+            runtime_error(ec, node, "unknown function '%s'", node->data.func_call.name);
+            return value_nil();
+    }
+}
+
+static value_t eval_expr(eval_context_t* ec, const ast_node_t* node) {
+    switch (node->type) {
+        case AST_INTEGER_LITERAL:
+            return value_int(node->data.integer_literal.value);
+        case AST_FLOAT_LITERAL:
+            return value_float(node->data.float_literal.value);
+        case AST_STRING_LITERAL:
+            // 字面量在加载时已解码, 这里直接引用
+            return value_view(node->data.string_literal.value, node->data.string_literal.length);
+        case AST_IDENTIFIER:
+            if (node->data.identifier.slot >= 0) {
+                return ec->slots[node->data.identifier.slot];
+            }
+            if (node->value_type && node->value_type->kind == TYPE_STRUCT) {
+                return ec->request->self;
+            }
+            return value_nil();
+        case AST_ARRAY_LITERAL:
+            return eval_array_literal(ec, node);
+        case AST_MEMBER_ACCESS:
+            return eval_member(ec, node);
+        case AST_MAP_ACCESS:
+            return eval_index(ec, node);
+        case AST_FUNC_CALL:
+            return eval_builtin(ec, node);
+        case AST_UNARY_EXPR:
+            return eval_unary(ec, node);
+        case AST_BINARY_EXPR:
+            return eval_binary(ec, node);
+        default:
+            runtime_error(ec, node, "statement used as an expression");
+            return value_nil();
+    }
+}
+
+static exec_status_t exec_block(eval_context_t* ec, const ast_list_t* stmts);
+
+static int count_iteration(eval_context_t* ec, const ast_node_t* node) {
+    if (++ec->iterations > EVAL_MAX_ITERATIONS) {
+        runtime_error(ec, node, "loop exceeded %d iterations", EVAL_MAX_ITERATIONS);
+        return 0;
+    }
+    return 1;
+}
+
+static exec_status_t exec_for(eval_context_t* ec, const ast_node_t* node) {
+    value_t range = eval_expr(ec, node->data.for_stmt.range);
+    value_t* it = &ec->slots[node->data.for_stmt.slot];
+    const ast_list_t* body = node->data.for_stmt.body;
+    exec_status_t status;
+    if (ec->halted) return halt_status(ec);
+
+    switch (range.tag) {
+        case VALUE_ARRAY: {
+            const value_array_t* array = range.array.ptr;
+            for (int i = 0; i < array->count; i++) {
+                if (!count_iteration(ec, node)) return EXEC_ERROR;
+                *it = array->items[i];
+                if ((status = exec_block(ec, body)) != EXEC_NEXT) return status;
+            }
+            break;
+        }
+        case VALUE_MAP: {
+            const value_map_t* map = range.map.ptr;
+            for (int i = 0; i < map->count; i++) {
+                if (!count_iteration(ec, node)) return EXEC_ERROR;
+                *it = map->keys[i];
+                if ((status = exec_block(ec, body)) != EXEC_NEXT) return status;
+            }
+            break;
+        }
+        case VALUE_INT:
+            for (int64_t i = 0; i < range.i.value; i++) {
+                if (!count_iteration(ec, node)) return EXEC_ERROR;
+                *it = value_int(i);
+                if ((status = exec_block(ec, body)) != EXEC_NEXT) return status;
+            }
+            break;
+        default:
+            // nil 的 map 或数组不迭代
+            break;
+    }
+    return EXEC_NEXT;
+}
+
+static exec_status_t exec_stmt(eval_context_t* ec, const ast_node_t* stmt) {
+    exec_status_t status;
+
+    switch (stmt->type) {
+        case AST_LET_STMT:
+            ec->slots[stmt->data.let_stmt.slot] = stmt->data.let_stmt.init ?
+                eval_expr(ec, stmt->data.let_stmt.init) : value_nil();
+            break;
+
+        case AST_ASSIGN_STMT: {
+            const ast_node_t* target = stmt->data.assign_stmt.target;
+            ec->slots[target->data.identifier.slot] = eval_expr(ec, stmt->data.assign_stmt.value);
+            break;
+        }
+
+        case AST_IF_STMT: {
+            int cond = eval_expr(ec, stmt->data.if_stmt.condition).i.value != 0;
+            if (ec->halted) return halt_status(ec);
+            return exec_block(ec, cond ? stmt->data.if_stmt.then_body
+                                       : stmt->data.if_stmt.else_body);
+        }
+
+        case AST_WHILE_STMT:
+            while (eval_expr(ec, stmt->data.while_stmt.condition).i.value) {
+                if (ec->halted) return halt_status(ec);
+                if (!count_iteration(ec, stmt)) return EXEC_ERROR;
+                if ((status = exec_block(ec, stmt->data.while_stmt.body)) != EXEC_NEXT) {
+                    return status;
+                }
+            }
+            break;
+
+        case AST_FOR_STMT:
+            return exec_for(ec, stmt);
+
+        case AST_RETURN_STMT:
+            ec->verdict = stmt->data.return_stmt.type;
+            return EXEC_RETURN;
+
+        default:
+            eval_expr(ec, stmt);
+            break;
+    }
+    return ec->halted ? halt_status(ec) : EXEC_NEXT;
+}
+
+static exec_status_t exec_block(eval_context_t* ec, const ast_list_t* stmts) {
+    for (; stmts; stmts = stmts->next) {
+        if (!stmts->node) continue;
+        exec_status_t status = exec_stmt(ec, stmts->node);
+        if (status != EXEC_NEXT) return status;
+    }
+    return EXEC_NEXT;
+}
+
+static exec_status_t exec_rule(eval_context_t* ec, const compiled_rule_t* rule) {
+    ec->rule = rule;
+    ec->verdict = RETURN_CONTINUE;
+    ec->halted = 0;
+    ec->suspended = 0;
+    ec->iterations = 0;
+
+    exec_status_t status = exec_block(ec, rule->node->data.rule.body);
+    ec->rule = NULL;
+    return status;
+}
+
+// 从第一个未完成的规则开始执行, 挂起的规则不阻塞后面的规则,
+// 这样相互独立的规则发出的查询可以合并为一次往返
+static eval_status_t run_task(eval_context_t* ec, eval_task_t* task) {
+    ec->task = task;
+    ec->request = task->request;
+    ec->speculative = 0;
+
+    for (int i = task->first; i < task->count; i++) {
+        // 已有结论的规则之后的规则不影响结果
+        if (task->states[i] == TASK_RULE_VERDICT) break;
+        if (task->states[i] != TASK_RULE_WAITING) continue;
+
+        const compiled_rule_t* rule = task->rules[i];
+        ec->stats.rules_evaluated++;
+
+        exec_status_t status = exec_rule(ec, rule);
+        if (status == EXEC_PENDING) {
+            // 之后的规则都是提前执行的, 前面的规则可能给出结论
+            ec->speculative = 1;
+            continue;
+        }
+        if (status == EXEC_ERROR) {
+            ec->stats.errors++;
+            task->states[i] = TASK_RULE_CONTINUE;
+            continue;
+        }
+        if (status == EXEC_RETURN && ec->verdict != RETURN_CONTINUE) {
+            task->states[i] = TASK_RULE_VERDICT;
+            task->verdicts[i] = ec->verdict;
+            break;
+        }
+        task->states[i] = TASK_RULE_CONTINUE;
+    }
+
+    ec->task = NULL;
+    ec->request = NULL;
+
+    while (task->first < task->count && task->states[task->first] == TASK_RULE_CONTINUE) {
+        task->first++;
+    }
+    if (task->first == task->count) {
+        return EVAL_DONE;
+    }
+    if (task->states[task->first] == TASK_RULE_VERDICT) {
+        task->result.verdict = task->verdicts[task->first];
+        task->result.rule = task->rules[task->first];
+        return EVAL_DONE;
+    }
+    ec->stats.suspensions++;
+    return EVAL_PENDING;
+}
+
+eval_status_t eval_start(eval_context_t* ctx, eval_task_t* task, request_t* request) {
+    const rule_engine_t* engine = ctx->engine;
+
+    memset(task, 0, sizeof(*task));
+    task->request = request;
+    task->result.verdict = RETURN_CONTINUE;
+    ctx->stats.requests++;
+
+    engine_fill_presence(engine, request, ctx->presence);
+    engine_select_rules(engine, ctx->presence, ctx->selection);
+    ctx->stats.rules_selected += ctx->selection->count;
+
+    // 候选规则复制到请求 arena, 挂起期间上下文可以处理其他请求
+    int n = ctx->selection->count;
+    task->rules = palloc(request->arena, sizeof(compiled_rule_t*) * (n + 1));
+    task->states = palloc(request->arena, n + 1);
+    task->verdicts = palloc(request->arena, sizeof(return_type_t) * (n + 1));
+    if (!task->rules || !task->states || !task->verdicts) {
+        fprintf(stderr, "Error: out of memory while evaluating request\n");
+        ctx->stats.errors++;
+        return EVAL_DONE;
+    }
+    memcpy(task->rules, ctx->selection->rules, sizeof(compiled_rule_t*) * n);
+    memset(task->states, TASK_RULE_WAITING, n);
+    task->count = n;
+
+    return run_task(ctx, task);
+}
+
+eval_status_t eval_resume(eval_context_t* ctx, eval_task_t* task) {
+    return run_task(ctx, task);
+}
+
+lookup_t* eval_task_lookups(eval_task_t* task, int* count) {
+    lookup_t* lookups = task->lookups + task->submitted;
+    *count = task->lookup_count - task->submitted;
+    task->submitted = task->lookup_count;
+    return lookups;
+}
+
+eval_result_t eval_request(eval_context_t* ctx, request_t* request) {
+    eval_task_t task;
+    eval_status_t status = eval_start(ctx, &task, request);
+
+    while (status == EVAL_PENDING) {
+        int count;
+        lookup_t* lookups = eval_task_lookups(&task, &count);
+        // 只等待本任务的批次, 同一 sidecar 上其他挂起任务的批次不受影响
+        if (!ctx->sidecar || sidecar_submit(ctx->sidecar, lookups, count, &task) != 0 ||
+            sidecar_complete(ctx->sidecar, &task) != 0) {
+            // 没有 sidecar 时查询按失败处理
+            for (int i = 0; i < count; i++) {
+                lookups[i].state = LOOKUP_FAILED;
+            }
+        }
+        status = eval_resume(ctx, &task);
+    }
+    return task.result;
+}
@@ -43,11 +43,10 @@ int yyparse(parser_context_t* ctx);
 %type <node> struct_member expression primary_expression unary_expression
 %type <node> let_statement if_statement for_statement while_statement
 %type <node> return_statement assignment_statement function_call
-%type <node> array_literal rule_statement
+%type <node> array_literal rule_statement rule_modifiers modifier_list
 %type <list> namespace_sections namespace_items_list rule_statements namespace_items
-%type <list> struct_members array_items identifier_list
+%type <list> struct_members array_items identifier_list after_modifiers before_modifiers
 %type <str_val> rule_name type_spec basic_type map_type array_type
-%type <op> comparison_operator
 
 %right '=' ADD_ASSIGN SUB_ASSIGN MUL_ASSIGN DIV_ASSIGN MOD_ASSIGN
 %right BAND_ASSIGN BOR_ASSIGN BXOR_ASSIGN LSHIFT_ASSIGN RSHIFT_ASSIGN
@@ -56,7 +55,7 @@ int yyparse(parser_context_t* ctx);
 %left BOR
 %left BXOR
 %left BAND
-%left EQ NE
+%left EQ NE IN
 %left GT LT GE LE
 %left LSHIFT RSHIFT
 %left '+' '-'
@@ -291,7 +290,7 @@ assignment_statement
     ;
 
 primary_expression
-    : IDENTIFIER
+    : IDENTIFIER %prec '.'
     {
         $$ = create_identifier_node(ctx, $1);
         free($1);
@@ -327,6 +326,20 @@ primary_expression
     {
         $$ = $2;
     }
+    | primary_expression '.' IDENTIFIER
+    {
+        ast_node_t* node = create_ast_node(ctx, AST_MEMBER_ACCESS);
+        node->data.member_access.target = $1;
+        node->data.member_access.member = $3;
+        $$ = node;
+    }
+    | primary_expression '[' expression ']'
+    {
+        ast_node_t* node = create_ast_node(ctx, AST_MAP_ACCESS);
+        node->data.map_access.target = $1;
+        node->data.map_access.key = $3;
+        $$ = node;
+    }
     ;
 
 unary_expression
@@ -355,20 +368,6 @@ expression
     {
         $$ = $1;
     }
-    | expression '.' IDENTIFIER
-    {
-        ast_node_t* node = create_ast_node(ctx, AST_MEMBER_ACCESS);
-        node->data.member_access.target = $1;
-        node->data.member_access.member = $3;
-        $$ = node;
-    }
-    | expression '[' expression ']'
-    {
-        ast_node_t* node = create_ast_node(ctx, AST_MAP_ACCESS);
-        node->data.map_access.target = $1;
-        node->data.map_access.key = $3;
-        $$ = node;
-    }
     | expression INC
     {
         ast_node_t* node = create_ast_node(ctx, AST_UNARY_EXPR);
@@ -503,9 +502,41 @@ expression
     {
         $$ = create_binary_expr_node(ctx, OP_RSHIFT, $1, $3);
     }
-    | expression comparison_operator expression
+    | expression EQ expression
+    {
+        $$ = create_binary_expr_node(ctx, OP_EQ, $1, $3);
+    }
+    | expression NE expression
+    {
+        $$ = create_binary_expr_node(ctx, OP_NE, $1, $3);
+    }
+    | expression GT expression
+    {
+        $$ = create_binary_expr_node(ctx, OP_GT, $1, $3);
+    }
+    | expression LT expression
+    {
+        $$ = create_binary_expr_node(ctx, OP_LT, $1, $3);
+    }
+    | expression GE expression
+    {
+        $$ = create_binary_expr_node(ctx, OP_GE, $1, $3);
+    }
+    | expression LE expression
     {
-        $$ = create_binary_expr_node(ctx, $2, $1, $3);
+        $$ = create_binary_expr_node(ctx, OP_LE, $1, $3);
+    }
+    | expression IN expression
+    {
+        $$ = create_binary_expr_node(ctx, OP_IN, $1, $3);
+    }
+    | expression AND expression
+    {
+        $$ = create_binary_expr_node(ctx, OP_AND, $1, $3);
+    }
+    | expression OR expression
+    {
+        $$ = create_binary_expr_node(ctx, OP_OR, $1, $3);
     }
     ;
 
@@ -597,6 +628,14 @@ function_call
         node->data.func_call.args = args;
         $$ = node;
     }
+    | IDENTIFIER '(' array_items ')'
+    {
+        // 其余内置函数按普通调用解析, 由类型检查按名字查找
+        ast_node_t* node = create_ast_node(ctx, AST_FUNC_CALL);
+        node->data.func_call.name = $1;
+        node->data.func_call.args = $3;
+        $$ = node;
+    }
     ;
 
 array_literal
@@ -624,21 +663,10 @@ array_items
     }
     ;
 
-comparison_operator
-    : EQ { $$ = OP_EQ; }
-    | NE { $$ = OP_NE; }
-    | GT { $$ = OP_GT; }
-    | LT { $$ = OP_LT; }
-    | GE { $$ = OP_GE; }
-    | LE { $$ = OP_LE; }
-    | AND { $$ = OP_AND; }
-    | OR { $$ = OP_OR; }
-    ;
-
 rule_declaration
     : RULE rule_name rule_modifiers '{' rule_statements '}'
     {
-        ast_node_t* node = create_ast_node(ctx, AST_RULE);
+        ast_node_t* node = $3;
         node->data.rule.name = $2;
         node->data.rule.body = $5;
         $$ = node;
@@ -658,22 +686,50 @@ rule_name
 
 rule_modifiers
     : /* empty */
+    {
+        $$ = create_ast_node(ctx, AST_RULE);
+    }
     | modifier_list
+    {
+        $$ = $1;
+    }
     ;
 
 modifier_list
     : after_modifiers
+    {
+        ast_node_t* node = create_ast_node(ctx, AST_RULE);
+        node->data.rule.after_rules = $1;
+        $$ = node;
+    }
     | before_modifiers
+    {
+        ast_node_t* node = create_ast_node(ctx, AST_RULE);
+        node->data.rule.before_rules = $1;
+        $$ = node;
+    }
     | after_modifiers before_modifiers
+    {
+        ast_node_t* node = create_ast_node(ctx, AST_RULE);
+        node->data.rule.after_rules = $1;
+        node->data.rule.before_rules = $2;
+        $$ = node;
+    }
     | before_modifiers after_modifiers
+    {
+        ast_node_t* node = create_ast_node(ctx, AST_RULE);
+        node->data.rule.after_rules = $2;
+        node->data.rule.before_rules = $1;
+        $$ = node;
+    }
     ;
 
 after_modifiers
-    : AFTER identifier_list
+    : AFTER identifier_list { $$ = $2; }
     ;
 
 before_modifiers
-    : BEFORE identifier_list
+    : BEFORE identifier_list { $$ = $2; }
     ;
 
 identifier_list
@@ -1,14 +1,447 @@
 #define _POSIX_C_SOURCE 200809L
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 #include "ast.h"
+#include "checker.h"
+#include "hash.h"
+#include "engine.h"
+#include "eval.h"
 #include "parser.h"
+#include "ruleset.h"
 
 extern FILE* yyin;
 extern int yylineno;
 extern int yyparse(parser_context_t* ctx);
 
+static const char* verdict_names[] = {"continue", "skip", "block"};
+
+static char* read_file(const char* path, size_t* len) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return NULL;
+
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char* buf = malloc(size > 0 ? size : 1);
+    if (buf && fread(buf, 1, size, f) != (size_t)size) {
+        free(buf);
+        buf = NULL;
+    }
+    fclose(f);
+    *len = buf ? (size_t)size : 0;
+    return buf;
+}
+
+// 请求文件: 头部行, 空行, 然后是 k=v&... 参数.
+// 头部放入 headers 成员, 与字符串成员同名的头部同时写入该成员, 参数作为关键字
+static void load_request(request_t* request, const char* buf, size_t len) {
+    const char* end = buf + len;
+    const char* body = end;
+    for (const char* p = buf; p < end; p++) {
+        // 空行分隔头部与参数
+        if (*p == '\n' && p + 1 < end && (p[1] == '\n' || p[1] == '\r')) {
+            body = p + 1;
+            break;
+        }
+    }
+
+    value_map_t* headers = request_parse_headers(request, buf, body - buf);
+    const type_t* type = request->type;
+    for (int i = 0; headers && type && i < type->field_count; i++) {
+        const type_t* ft = type->fields[i].type;
+        const char* name = type->fields[i].name;
+        if (ft && ft->kind == TYPE_MAP && strcmp(name, "headers") == 0) {
+            request_set_field(request, i, value_from_map(headers));
+        } else if (ft && ft->kind == TYPE_STRING) {
+            const value_t* v = value_map_find(headers, name, strlen(name));
+            if (v) request_set_field(request, i, *v);
+        }
+    }
+
+    while (body < end && (*body == '\n' || *body == '\r')) body++;
+    size_t body_len = end - body;
+    while (body_len > 0 && (body[body_len - 1] == '\n' || body[body_len - 1] == '\r')) body_len--;
+    request_set_keywords(request, request_parse_params(request, body, body_len));
+}
+
+static void print_result(const char* path, const eval_result_t* result) {
+    printf("Request %s: %s", path, verdict_names[result->verdict]);
+    if (result->rule) {
+        printf(" by %s::%s", result->rule->namespace_name, result->rule->name);
+    }
+    printf("\n");
+}
+
+// 提交挂起请求的查询, 返回是否仍在等待
+static int submit_lookups(sidecar_t* sidecar, eval_task_t* task) {
+    int count;
+    lookup_t* lookups = eval_task_lookups(task, &count);
+    if (sidecar_submit(sidecar, lookups, count, task) == 0) return 1;
+
+    for (int i = 0; i < count; i++) {
+        lookups[i].state = LOOKUP_FAILED;
+    }
+    return 0;
+}
+
+// 在同一个求值上下文中交替处理多个请求文件:
+// 请求等待 sidecar 查询时先处理其他请求, 查询完成后再恢复
+static int run_requests(rule_engine_t* engine, char** paths, int count) {
+    int result = 0;
+    sidecar_t* sidecar = create_sidecar();
+    eval_context_t* ec = create_eval_context(engine);
+    request_t** requests = calloc(count, sizeof(request_t*));
+    eval_task_t* tasks = calloc(count, sizeof(eval_task_t));
+    char** bufs = calloc(count, sizeof(char*));
+    if (!sidecar || !ec || !requests || !tasks || !bufs) {
+        fprintf(stderr, "Failed to create evaluation context\n");
+        result = 1;
+        goto cleanup;
+    }
+
+    printf("\n");
+    for (int i = 0; i < count; i++) {
+        size_t len;
+        bufs[i] = read_file(paths[i], &len);
+        requests[i] = bufs[i] ? create_request(engine->global_type) : NULL;
+        if (!requests[i]) {
+            fprintf(stderr, "Cannot load request file '%s'\n", paths[i]);
+            result = 1;
+            continue;
+        }
+
+        load_request(requests[i], bufs[i], len);
+        eval_status_t status = eval_start(ec, &tasks[i], requests[i]);
+        while (status == EVAL_PENDING && !submit_lookups(sidecar, &tasks[i])) {
+            status = eval_resume(ec, &tasks[i]);
+        }
+        if (status == EVAL_DONE) print_result(paths[i], &tasks[i].result);
+    }
+
+    eval_task_t* task;
+    while ((task = sidecar_poll(sidecar)) != NULL) {
+        eval_status_t status = eval_resume(ec, task);
+        while (status == EVAL_PENDING && !submit_lookups(sidecar, task)) {
+            status = eval_resume(ec, task);
+        }
+        if (status == EVAL_DONE) print_result(paths[task - tasks], &task->result);
+    }
+
+    printf("(%llu requests, %llu rule runs for %llu selected rules, %llu errors, "
+           "%llu lookups in %llu round trips)\n",
+           (unsigned long long)ec->stats.requests,
+           (unsigned long long)ec->stats.rules_evaluated,
+           (unsigned long long)ec->stats.rules_selected,
+           (unsigned long long)ec->stats.errors,
+           (unsigned long long)sidecar->lookups,
+           (unsigned long long)sidecar->round_trips);
+
+cleanup:
+    for (int i = 0; requests && i < count; i++) {
+        destroy_request(requests[i]);
+    }
+    for (int i = 0; bufs && i < count; i++) {
+        free(bufs[i]);
+    }
+    free(bufs);
+    free(tasks);
+    free(requests);
+    destroy_eval_context(ec);
+    destroy_sidecar(sidecar);
+    return result;
+}
+
+// 多租户模式: 每个参数为 name=file[,file...], 文件按顺序叠加,
+// 同名命名空间后者覆盖前者的同名规则. 内容相同的命名空间在租户之间共享
+static int run_tenants(char** specs, int count) {
+    int result = 0;
+    ruleset_registry_t* registry = create_ruleset_registry();
+    tenant_ruleset_t** tenants = calloc(count, sizeof(tenant_ruleset_t*));
+    if (!registry || !tenants) {
+        fprintf(stderr, "Failed to create ruleset registry\n");
+        destroy_ruleset_registry(registry);
+        free(tenants);
+        return 1;
+    }
+
+    for (int i = 0; i < count; i++) {
+        char* spec = strdup(specs[i]);
+        char* files = spec ? strchr(spec, '=') : NULL;
+        if (!files || files == spec || !files[1]) {
+            fprintf(stderr, "Invalid tenant spec '%s', expected name=file[,file...]\n", specs[i]);
+            free(spec);
+            result = 1;
+            continue;
+        }
+        *files++ = '\0';
+
+        char* paths[64];
+        int path_count = 0;
+        for (char* p = strtok(files, ","); p && path_count < 64; p = strtok(NULL, ",")) {
+            paths[path_count++] = p;
+        }
+
+        tenants[i] = load_tenant_ruleset(registry, spec, paths, path_count);
+        if (tenants[i]) {
+            printf("Tenant %s:\n", tenants[i]->name);
+            print_rule_engine(tenants[i]->engine);
+        } else {
+            fprintf(stderr, "Failed to load tenant '%s'\n", spec);
+            result = 1;
+        }
+        free(spec);
+    }
+
+    printf("(%d tenants, %d distinct namespaces, %zu bytes)\n",
+           count, registry->namespace_count, registry_memory(registry));
+
+    for (int i = 0; i < count; i++) {
+        destroy_tenant_ruleset(tenants[i]);
+    }
+    free(tenants);
+    destroy_ruleset_registry(registry);
+    return result;
+}
+
+// 压测线程, 结果只在结束时写回
+typedef struct bench_worker {
+    _Alignas(CACHE_LINE_SIZE) pthread_t thread;
+    const rule_engine_t* engine;
+    char** bufs;                 // 请求文件内容, 所有线程只读共享
+    size_t* lens;
+    int count;
+    long iterations;
+    double seconds;
+    eval_stats_t stats;
+    int failed;
+} bench_worker_t;
+
+static void* bench_thread(void* arg) {
+    bench_worker_t* w = arg;
+    sidecar_t* sidecar = create_sidecar();
+    eval_context_t* ec = create_eval_context(w->engine);
+    request_t* request = create_request(w->engine->global_type);
+    if (!sidecar || !ec || !request || (uintptr_t)ec % CACHE_LINE_SIZE != 0) {
+        w->failed = 1;
+        goto cleanup;
+    }
+    eval_set_sidecar(ec, sidecar);
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (long i = 0; i < w->iterations; i++) {
+        int r = (int)(i % w->count);
+        request_reset(request);
+        load_request(request, w->bufs[r], w->lens[r]);
+        eval_request(ec, request);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    w->seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    w->stats = ec->stats;
+
+cleanup:
+    destroy_request(request);
+    destroy_eval_context(ec);
+    destroy_sidecar(sidecar);
+    return NULL;
+}
+
+// 压测期间在另一个线程反复加载和卸载租户, 与求值并发.
+// 交替加载单个文件 (命中已有命名空间, 只改引用计数) 和同一文件两次
+// (创建并释放覆盖合并, 修改注册表的哈希桶)
+typedef struct bench_loader {
+    pthread_t thread;
+    ruleset_registry_t* registry;
+    char* path;
+    atomic_int stop;
+    long loads;
+    int failed;
+} bench_loader_t;
+
+static void* bench_reload(void* arg) {
+    bench_loader_t* loader = arg;
+    char* paths[2] = {loader->path, loader->path};
+    while (!atomic_load(&loader->stop)) {
+        tenant_ruleset_t* tenant = load_tenant_ruleset(loader->registry, "reload", paths,
+                                                       1 + (int)(loader->loads & 1));
+        if (!tenant) {
+            loader->failed = 1;
+            break;
+        }
+        destroy_tenant_ruleset(tenant);
+        loader->loads++;
+    }
+    return NULL;
+}
+
+// 跳过 [skip, skip_end) 的内存池内容校验和
+static uint64_t pool_checksum(uint64_t h, const memory_pool_t* pool,
+                              const char* skip, const char* skip_end) {
+    for (const memory_pool_t* p = pool; p; p = p->next) {
+        if (skip >= p->start && skip < p->current) {
+            h = fnv1a_64(h, p->start, skip - p->start);
+            h = fnv1a_64(h, skip_end, p->current - skip_end);
+        } else {
+            h = fnv1a_64(h, p->start, p->current - p->start);
+        }
+    }
+    return h;
+}
+
+// 命名空间中求值会读取的内容, 不含注册表维护的字段
+static uint64_t namespace_checksum(uint64_t h, const compiled_namespace_t* ns) {
+    h = pool_checksum(h, ns->pool, (const char*)&ns->hash, (const char*)(ns + 1));
+    if (ns->base) {
+        h = namespace_checksum(h, ns->base);
+        h = namespace_checksum(h, ns->overlay);
+    }
+    return h;
+}
+
+// 特征表快照的桶头和从桶头可达的条目
+static uint64_t features_checksum(uint64_t h, const feature_table_t* table) {
+    h = fnv1a_64(h, table->buckets, sizeof(table->buckets));
+    h = fnv1a_64(h, &table->count, sizeof(table->count));
+    for (int b = 0; b < FEATURE_BUCKETS; b++) {
+        for (const feature_entry_t* e = table->buckets[b]; e; e = e->next) {
+            h = fnv1a_64(h, e, sizeof(*e));
+            if (e->key) h = fnv1a_64(h, e->key, e->key_len);
+        }
+    }
+    return h;
+}
+
+// 求值读取的全部共享数据: 引擎、特征表快照和引擎引用的命名空间
+static uint64_t ruleset_checksum(const tenant_ruleset_t* tenant) {
+    const rule_engine_t* engine = tenant->engine;
+    uint64_t h = pool_checksum(FNV64_OFFSET, engine->pool, NULL, NULL);
+    h = features_checksum(h, engine->features);
+    for (int i = 0; i < engine->namespace_count; i++) {
+        h = namespace_checksum(h, engine->namespaces[i]);
+    }
+    return h;
+}
+
+// 多线程压测: 所有线程共享同一个已编译规则集, 每个线程一个求值上下文,
+// 同时有一个线程反复加载租户. 线程数从 1 倍增到 max_threads,
+// 单线程吞吐不随线程数下降说明求值路径上没有争用;
+// 压测前后规则集内容不变说明求值期间没有写入共享数据.
+// 用 -DRULEC_TSAN=ON 构建时由 ThreadSanitizer 检查求值与加载之间的数据竞争
+static int run_bench(int max_threads, long iterations, char* rule_path,
+                     char** paths, int count) {
+    int result = 0;
+    ruleset_registry_t* registry = create_ruleset_registry();
+    tenant_ruleset_t* tenant = registry ?
+        load_tenant_ruleset(registry, "bench", &rule_path, 1) : NULL;
+    char** bufs = calloc(count, sizeof(char*));
+    size_t* lens = calloc(count, sizeof(size_t));
+    // calloc 不保证 bench_worker_t 的缓存行对齐
+    bench_worker_t* workers = aligned_alloc(CACHE_LINE_SIZE, sizeof(bench_worker_t) * max_threads);
+    if (workers) memset(workers, 0, sizeof(bench_worker_t) * max_threads);
+    if (!tenant || !bufs || !lens || !workers) {
+        fprintf(stderr, "Failed to set up benchmark\n");
+        result = 1;
+        goto cleanup;
+    }
+    for (int i = 0; i < count; i++) {
+        bufs[i] = read_file(paths[i], &lens[i]);
+        if (!bufs[i]) {
+            fprintf(stderr, "Cannot load request file '%s'\n", paths[i]);
+            result = 1;
+            goto cleanup;
+        }
+    }
+
+    uint64_t before = ruleset_checksum(tenant);
+    printf("Benchmark: %d request files, %ld requests per thread\n", count, iterations);
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+        if (threads * 2 > max_threads) threads = max_threads;
+
+        bench_loader_t loader;
+        memset(&loader, 0, sizeof(loader));
+        loader.registry = registry;
+        loader.path = rule_path;
+        atomic_init(&loader.stop, 0);
+        int reloading = pthread_create(&loader.thread, NULL, bench_reload, &loader) == 0;
+
+        for (int i = 0; i < threads; i++) {
+            bench_worker_t* w = &workers[i];
+            memset(w, 0, sizeof(*w));
+            w->engine = tenant->engine;
+            w->bufs = bufs;
+            w->lens = lens;
+            w->count = count;
+            w->iterations = iterations;
+            if (pthread_create(&w->thread, NULL, bench_thread, w) != 0) {
+                w->failed = 1;
+            }
+        }
+
+        double slowest = 0;
+        uint64_t evaluated = 0;
+        for (int i = 0; i < threads; i++) {
+            if (!workers[i].failed) pthread_join(workers[i].thread, NULL);
+            if (workers[i].failed) {
+                fprintf(stderr, "Benchmark thread %d failed\n", i);
+                result = 1;
+            }
+            if (workers[i].seconds > slowest) slowest = workers[i].seconds;
+            evaluated += workers[i].stats.rules_evaluated;
+        }
+        if (reloading) {
+            atomic_store(&loader.stop, 1);
+            pthread_join(loader.thread, NULL);
+        }
+        if (loader.failed) {
+            fprintf(stderr, "Benchmark reload failed\n");
+            result = 1;
+        }
+
+        double total = slowest > 0 ? (double)iterations * threads / slowest : 0;
+        printf("  %2d threads: %12.0f requests/s, %10.0f per thread, %llu rule runs, "
+               "%ld concurrent reloads\n",
+               threads, total, total / threads, (unsigned long long)evaluated, loader.loads);
+        if (threads == max_threads) break;
+    }
+
+    uint64_t after = ruleset_checksum(tenant);
+    printf("Shared ruleset %s during evaluation (checksum %016llx)\n",
+           before == after ? "unchanged" : "MODIFIED", (unsigned long long)after);
+    if (before != after) result = 1;
+
+cleanup:
+    for (int i = 0; bufs && i < count; i++) {
+        free(bufs[i]);
+    }
+    free(bufs);
+    free(lens);
+    free(workers);
+    destroy_tenant_ruleset(tenant);
+    destroy_ruleset_registry(registry);
+    return result;
+}
+
 int main(int argc, char **argv) {
+    if (argc > 2 && strcmp(argv[1], "--tenants") == 0) {
+        return run_tenants(argv + 2, argc - 2);
+    }
+    if (argc > 5 && strcmp(argv[1], "--bench") == 0) {
+        int threads = atoi(argv[2]);
+        long iterations = atol(argv[3]);
+        if (threads < 1 || iterations < 1) {
+            fprintf(stderr, "Usage: %s --bench <threads> <requests> <file.rule> <request>...\n",
+                    argv[0]);
+            return 1;
+        }
+        return run_bench(threads, iterations, argv[4], argv + 5, argc - 5);
+    }
+
     // 创建解析器上下文
     parser_context_t* ctx = create_parser_context();
     if (!ctx) {
@@ -37,6 +470,11 @@ int main(int argc, char **argv) {
     // 重置行号并开始解析
     yylineno = 1;
     int result = yyparse(ctx);
+
+    // 类型检查与推断
+    if (result == 0 && ctx->root) {
+        check_program(ctx);
+    }
     
     printf("===================\n");
     if (result == 0 && ctx->error_count == 0) {
@@ -45,9 +483,24 @@ int main(int argc, char **argv) {
         if (ctx->root) {
             printf("\nAbstract Syntax Tree:\n");
             print_ast(ctx->root, 0);
+
+            // 规则排序与预过滤条件
+            rule_engine_t* engine = create_rule_engine(ctx);
+            if (engine) {
+                printf("\n");
+                print_rule_engine(engine);
+                // 可选的请求文件
+                if (argc > 2) {
+                    result = run_requests(engine, argv + 2, argc - 2);
+                }
+                destroy_rule_engine(engine);
+            } else {
+                result = 1;
+            }
         }
     } else {
         printf("Parsing failed with %d errors.\n", ctx->error_count);
+        result = 1;
     }
     
     // 清理资源
@@ -1,3 +1,4 @@
+#include <stdint.h>
 #include <string.h>
 #include "pool.h"
 
@@ -38,6 +39,13 @@ void* palloc(memory_pool_t* pool, size_t size) {
     return NULL;
 }
 
+void* palloc_aligned(memory_pool_t* pool, size_t size, size_t align) {
+    // palloc 已按 8 字节对齐, 多申请的部分足够向上取整
+    char* mem = palloc(pool, size + (align > 8 ? align - 8 : 0));
+    if (!mem) return NULL;
+    return (void*)(((uintptr_t)mem + align - 1) & ~(uintptr_t)(align - 1));
+}
+
 char* pstrdup(memory_pool_t* pool, const char* str) {
     size_t len = strlen(str) + 1;
     char* new_str = palloc(pool, len);
@@ -47,6 +55,22 @@ char* pstrdup(memory_pool_t* pool, const char* str) {
     return new_str;
 }
 
+// 重置内存池, 保留已申请的内存块供下次复用
+void reset_pool(memory_pool_t* pool) {
+    for (memory_pool_t* p = pool; p; p = p->next) {
+        p->current = p->start;
+    }
+}
+
+// 内存池占用的内存块总大小
+size_t pool_size(const memory_pool_t* pool) {
+    size_t size = 0;
+    for (const memory_pool_t* p = pool; p; p = p->next) {
+        size += p->size;
+    }
+    return size;
+}
+
 void destroy_pool(memory_pool_t* pool) {
     memory_pool_t* p = pool;
     while (p) {
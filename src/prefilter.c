@@ -0,0 +1,685 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "hash.h"
+#include "prefilter.h"
+#include "types.h"
+
+// 规则必要条件分析上下文
+typedef struct filter_ctx {
+    feature_table_t* table;
+    memory_pool_t* scratch;      // 分析期间的临时内存
+    const char* global_name;     // 全局结构体名, 如 req
+    const ast_node_t* rule;
+} filter_ctx_t;
+
+static uint32_t feature_hash(feature_kind_t kind, const char* member,
+                             const char* key, size_t key_len) {
+    uint32_t h = FNV32_OFFSET ^ (uint32_t)kind;
+    if (member) h = fnv1a_32(h, member, strlen(member));
+    h = fnv1a_32(h, "\0", 1);
+    if (key) h = fnv1a_32(h, key, key_len);
+    return h;
+}
+
+static int str_eq(const char* a, const char* b) {
+    if (!a || !b) return a == b;
+    return strcmp(a, b) == 0;
+}
+
+static int key_eq(const feature_entry_t* e, const char* key, size_t key_len) {
+    if (!e->key || !key) return e->key == key;
+    return e->key_len == key_len && memcmp(e->key, key, key_len) == 0;
+}
+
+void init_feature_table(feature_table_t* table, memory_pool_t* pool) {
+    memset(table, 0, sizeof(*table));
+    table->pool = pool;
+}
+
+int lookup_feature(const feature_table_t* table, feature_kind_t kind,
+                   const char* member, const char* key, size_t key_len) {
+    uint32_t h = feature_hash(kind, member, key, key_len);
+    for (feature_entry_t* e = table->buckets[h % FEATURE_BUCKETS]; e; e = e->next) {
+        if (e->kind == kind && str_eq(e->member, member) && key_eq(e, key, key_len)) {
+            return e->id;
+        }
+    }
+    return -1;
+}
+
+int intern_feature(feature_table_t* table, feature_kind_t kind,
+                   const char* member, const char* key, size_t key_len) {
+    int id = lookup_feature(table, kind, member, key, key_len);
+    if (id >= 0) return id;
+
+    feature_entry_t* e = palloc(table->pool, sizeof(feature_entry_t));
+    if (!e) return -1;
+    e->kind = kind;
+    e->member = member ? pstrdup(table->pool, member) : NULL;
+    e->key = NULL;
+    e->key_len = key ? key_len : 0;
+    if (key) {
+        // 解码后的字面量可能包含 \0, 按长度复制
+        e->key = palloc(table->pool, key_len + 1);
+        if (!e->key) return -1;
+        memcpy(e->key, key, key_len);
+        e->key[key_len] = '\0';
+    }
+    e->id = table->count++;
+
+    uint32_t h = feature_hash(kind, member, key, key_len);
+    e->next = table->buckets[h % FEATURE_BUCKETS];
+    table->buckets[h % FEATURE_BUCKETS] = e;
+    return e->id;
+}
+
+feature_snapshot_t* create_feature_snapshot(const feature_table_t* table) {
+    memory_pool_t* pool = create_pool(sizeof(feature_snapshot_t) + CACHE_LINE_SIZE);
+    if (!pool) return NULL;
+
+    feature_snapshot_t* snapshot = palloc_aligned(pool, sizeof(feature_snapshot_t),
+                                                  _Alignof(feature_snapshot_t));
+    if (!snapshot) {
+        destroy_pool(pool);
+        return NULL;
+    }
+    snapshot->pool = pool;
+    snapshot->table = *table;
+    snapshot->table.pool = NULL;
+    snapshot->refcount = 1;
+    return snapshot;
+}
+
+void destroy_feature_snapshot(feature_snapshot_t* snapshot) {
+    if (snapshot) {
+        destroy_pool(snapshot->pool);
+    }
+}
+
+// 特征集合运算
+static feature_set_t set_always(void) {
+    feature_set_t s = {1, 0, NULL};
+    return s;
+}
+
+static feature_set_t set_never(void) {
+    feature_set_t s = {0, 0, NULL};
+    return s;
+}
+
+static feature_set_t set_single(filter_ctx_t* fc, int id) {
+    if (id < 0) return set_always();
+    feature_set_t s = {0, 1, palloc(fc->scratch, sizeof(int))};
+    s.ids[0] = id;
+    return s;
+}
+
+static int set_is_never(feature_set_t s) {
+    return !s.always && s.count == 0;
+}
+
+// 析取: 任一条件成立
+static feature_set_t set_union(filter_ctx_t* fc, feature_set_t a, feature_set_t b) {
+    if (a.always || b.always) return set_always();
+    if (a.count == 0) return b;
+    if (b.count == 0) return a;
+
+    feature_set_t s = {0, 0, palloc(fc->scratch, sizeof(int) * (a.count + b.count))};
+    for (int i = 0; i < a.count; i++) {
+        s.ids[s.count++] = a.ids[i];
+    }
+    for (int i = 0; i < b.count; i++) {
+        int dup = 0;
+        for (int j = 0; j < a.count; j++) {
+            if (a.ids[j] == b.ids[i]) {
+                dup = 1;
+                break;
+            }
+        }
+        if (!dup) s.ids[s.count++] = b.ids[i];
+    }
+    return s;
+}
+
+// 合取: 两个条件都必须成立, 任取其一即为必要条件, 选择更有选择性的一侧
+static feature_set_t set_pick(feature_set_t a, feature_set_t b) {
+    if (set_is_never(a)) return a;
+    if (set_is_never(b)) return b;
+    if (a.always) return b;
+    if (b.always) return a;
+    return a.count <= b.count ? a : b;
+}
+
+// 识别请求字段访问: req.member 或 req.member[key]
+static int field_feature(filter_ctx_t* fc, const ast_node_t* node) {
+    if (!node || !fc->global_name) return -1;
+
+    // 跳过类型检查插入的 int -> float 转换
+    if (node->type == AST_UNARY_EXPR && node->data.unary_expr.op == OP_TO_FLOAT) {
+        node = node->data.unary_expr.operand;
+    }
+
+    const ast_node_t* key = NULL;
+    if (node->type == AST_MAP_ACCESS) {
+        key = node->data.map_access.key;
+        node = node->data.map_access.target;
+    }
+    if (!node || node->type != AST_MEMBER_ACCESS) return -1;
+
+    const ast_node_t* root = node->data.member_access.target;
+    if (!root || root->type != AST_IDENTIFIER ||
+        strcmp(root->data.identifier.name, fc->global_name) != 0) {
+        return -1;
+    }
+
+    const char* member = node->data.member_access.member;
+    if (key && key->type == AST_STRING_LITERAL) {
+        return intern_feature(fc->table, FEATURE_FIELD, member, key->data.string_literal.value,
+                              key->data.string_literal.length);
+    }
+    return intern_feature(fc->table, FEATURE_FIELD, member, NULL, 0);
+}
+
+// 查找 let name = nil 且之后没有被重新赋值的局部变量
+static void scan_let(const ast_list_t* stmts, const char* name, int* nil_let, int* assigned) {
+    for (; stmts; stmts = stmts->next) {
+        const ast_node_t* stmt = stmts->node;
+        if (!stmt) continue;
+
+        switch (stmt->type) {
+            case AST_LET_STMT:
+                if (strcmp(stmt->data.let_stmt.name, name) == 0) {
+                    const ast_node_t* init = stmt->data.let_stmt.init;
+                    if (init && init->type == AST_IDENTIFIER &&
+                        strcmp(init->data.identifier.name, "nil") == 0) {
+                        (*nil_let)++;
+                    } else {
+                        (*assigned)++;
+                    }
+                }
+                break;
+            case AST_ASSIGN_STMT: {
+                const ast_node_t* target = stmt->data.assign_stmt.target;
+                if (target && target->type == AST_IDENTIFIER &&
+                    strcmp(target->data.identifier.name, name) == 0) {
+                    (*assigned)++;
+                }
+                break;
+            }
+            case AST_BINARY_EXPR:
+            case AST_UNARY_EXPR: {
+                // 复合赋值和自增自减视为重新赋值
+                const ast_node_t* target = stmt->type == AST_BINARY_EXPR ?
+                    stmt->data.binary_expr.left : stmt->data.unary_expr.operand;
+                if (target && target->type == AST_IDENTIFIER &&
+                    strcmp(target->data.identifier.name, name) == 0) {
+                    (*assigned)++;
+                }
+                break;
+            }
+            case AST_FOR_STMT:
+                if (strcmp(stmt->data.for_stmt.iterator, name) == 0) {
+                    (*assigned)++;
+                }
+                scan_let(stmt->data.for_stmt.body, name, nil_let, assigned);
+                break;
+            case AST_WHILE_STMT:
+                scan_let(stmt->data.while_stmt.body, name, nil_let, assigned);
+                break;
+            case AST_IF_STMT:
+                scan_let(stmt->data.if_stmt.then_body, name, nil_let, assigned);
+                scan_let(stmt->data.if_stmt.else_body, name, nil_let, assigned);
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+static int is_nil(filter_ctx_t* fc, const ast_node_t* node) {
+    if (!node || node->type != AST_IDENTIFIER) return 0;
+
+    const char* name = node->data.identifier.name;
+    if (strcmp(name, "nil") == 0) return 1;
+
+    int nil_let = 0, assigned = 0;
+    scan_let(fc->rule->data.rule.body, name, &nil_let, &assigned);
+    return nil_let == 1 && assigned == 0;
+}
+
+static int is_literal(const ast_node_t* node) {
+    return node && (node->type == AST_STRING_LITERAL ||
+                    node->type == AST_INTEGER_LITERAL ||
+                    node->type == AST_FLOAT_LITERAL);
+}
+
+static feature_set_t condition_need(filter_ctx_t* fc, const ast_node_t* expr, int positive);
+
+// in 测试: 常量集合和 map 的键都不含 nil, 可为 nil 的字段只有存在时才可能命中
+static feature_set_t membership_need(filter_ctx_t* fc, const ast_node_t* expr, int positive) {
+    const ast_node_t* left = expr->data.binary_expr.left;
+    opcode_t opcode = expr->data.binary_expr.opcode;
+
+    if (!positive || (opcode != OPC_IN_SET && opcode != OPC_IN_MAP)) return set_always();
+    if (!left->value_type || !type_is_nullable(left->value_type)) return set_always();
+
+    int field = field_feature(fc, left);
+    if (field < 0) return set_always();
+    return set_single(fc, field);
+}
+
+// 比较表达式: 字段与 nil 或字面量比较
+static feature_set_t comparison_need(filter_ctx_t* fc, operator_type_t op,
+                                     const ast_node_t* left, const ast_node_t* right,
+                                     int positive) {
+    int field = field_feature(fc, left);
+    const ast_node_t* node = left;
+    const ast_node_t* other = right;
+    if (field < 0) {
+        field = field_feature(fc, right);
+        node = right;
+        other = left;
+    }
+    if (field < 0) return set_always();
+
+    // 缺失的 int/float 字段按 0 求值, 比较结果与字段是否存在无关
+    if (node->value_type && !type_is_nullable(node->value_type)) {
+        return set_always();
+    }
+
+    if (is_nil(fc, other)) {
+        // 只有 "字段 != nil" 为真 (或 "字段 == nil" 为假) 时才要求字段存在
+        if ((op == OP_NE && positive) || (op == OP_EQ && !positive)) {
+            return set_single(fc, field);
+        }
+        return set_always();
+    }
+
+    if (is_literal(other)) {
+        // nil 与任何字面量都不相等, 也不满足大小比较
+        switch (op) {
+            case OP_EQ:
+                return positive ? set_single(fc, field) : set_always();
+            case OP_NE:
+                return positive ? set_always() : set_single(fc, field);
+            case OP_GT:
+            case OP_LT:
+            case OP_GE:
+            case OP_LE:
+                return positive ? set_single(fc, field) : set_always();
+            default:
+                break;
+        }
+    }
+    return set_always();
+}
+
+// 计算使 expr 取值为 positive 的必要条件
+static feature_set_t condition_need(filter_ctx_t* fc, const ast_node_t* expr, int positive) {
+    if (!expr) return set_always();
+
+    switch (expr->type) {
+        case AST_UNARY_EXPR:
+            if (expr->data.unary_expr.op == OP_NOT) {
+                return condition_need(fc, expr->data.unary_expr.operand, !positive);
+            }
+            return set_always();
+
+        case AST_BINARY_EXPR: {
+            const ast_node_t* l = expr->data.binary_expr.left;
+            const ast_node_t* r = expr->data.binary_expr.right;
+            switch (expr->data.binary_expr.op) {
+                case OP_AND:
+                    if (positive) {
+                        return set_pick(condition_need(fc, l, 1), condition_need(fc, r, 1));
+                    }
+                    return set_union(fc, condition_need(fc, l, 0), condition_need(fc, r, 0));
+                case OP_OR:
+                    if (positive) {
+                        return set_union(fc, condition_need(fc, l, 1), condition_need(fc, r, 1));
+                    }
+                    return set_pick(condition_need(fc, l, 0), condition_need(fc, r, 0));
+                case OP_EQ:
+                case OP_NE:
+                case OP_GT:
+                case OP_LT:
+                case OP_GE:
+                case OP_LE:
+                    return comparison_need(fc, expr->data.binary_expr.op, l, r, positive);
+                case OP_IN:
+                    return membership_need(fc, expr, positive);
+                default:
+                    return set_always();
+            }
+        }
+
+        case AST_MEMBER_ACCESS:
+        case AST_MAP_ACCESS:
+            if (positive) {
+                return set_single(fc, field_feature(fc, expr));
+            }
+            return set_always();
+
+        case AST_FUNC_CALL: {
+            // match_keyword / match_keyword_value 只有在关键字出现时才可能为真
+            const ast_list_t* args = expr->data.func_call.args;
+            if (positive && args && args->node && args->node->type == AST_STRING_LITERAL &&
+                (strcmp(expr->data.func_call.name, "match_keyword") == 0 ||
+                 strcmp(expr->data.func_call.name, "match_keyword_value") == 0)) {
+                int id = intern_feature(fc->table, FEATURE_KEYWORD, NULL,
+                                        args->node->data.string_literal.value,
+                                        args->node->data.string_literal.length);
+                return set_single(fc, id);
+            }
+            return set_always();
+        }
+
+        default:
+            return set_always();
+    }
+}
+
+// 求值 expr 时调用 rate_count 的必要条件, 不调用时为 never.
+// 每次调用都会让计数器加一, 即使所在的条件最终不成立, 所以调用本身就是动作;
+// && 和 || 短路, 右侧的调用只在左侧取值为 true (||: false) 时发生
+static feature_set_t rate_count_need(filter_ctx_t* fc, const ast_node_t* expr) {
+    if (!expr) return set_never();
+
+    feature_set_t need = set_never();
+    switch (expr->type) {
+        case AST_FUNC_CALL:
+            if (expr->data.func_call.builtin == BUILTIN_RATE_COUNT) return set_always();
+            for (const ast_list_t* arg = expr->data.func_call.args; arg; arg = arg->next) {
+                need = set_union(fc, need, rate_count_need(fc, arg->node));
+            }
+            return need;
+        case AST_BINARY_EXPR: {
+            const ast_node_t* l = expr->data.binary_expr.left;
+            feature_set_t right = rate_count_need(fc, expr->data.binary_expr.right);
+            if (expr->data.binary_expr.op == OP_AND) {
+                right = set_pick(condition_need(fc, l, 1), right);
+            } else if (expr->data.binary_expr.op == OP_OR) {
+                right = set_pick(condition_need(fc, l, 0), right);
+            }
+            return set_union(fc, rate_count_need(fc, l), right);
+        }
+        case AST_UNARY_EXPR:
+            return rate_count_need(fc, expr->data.unary_expr.operand);
+        case AST_MAP_ACCESS:
+            return set_union(fc, rate_count_need(fc, expr->data.map_access.target),
+                             rate_count_need(fc, expr->data.map_access.key));
+        case AST_MEMBER_ACCESS:
+            return rate_count_need(fc, expr->data.member_access.target);
+        case AST_ARRAY_LITERAL:
+            for (const ast_list_t* item = expr->data.array_literal.items; item; item = item->next) {
+                need = set_union(fc, need, rate_count_need(fc, item->node));
+            }
+            return need;
+        default:
+            return set_never();
+    }
+}
+
+// 语句自身 (不含嵌套语句块) 产生副作用的必要条件: rate_count 计数或修改局部变量以外的状态.
+// 有副作用的语句与返回 skip/block 一样是动作, 它的条件必须计入规则的过滤条件
+static feature_set_t side_effect_need(filter_ctx_t* fc, const ast_node_t* stmt) {
+    const ast_node_t* target = NULL;
+    switch (stmt->type) {
+        case AST_IF_STMT:
+            return rate_count_need(fc, stmt->data.if_stmt.condition);
+        case AST_WHILE_STMT:
+            return rate_count_need(fc, stmt->data.while_stmt.condition);
+        case AST_FOR_STMT:
+            return rate_count_need(fc, stmt->data.for_stmt.range);
+        case AST_LET_STMT:
+            return rate_count_need(fc, stmt->data.let_stmt.init);
+        case AST_ASSIGN_STMT:
+            target = stmt->data.assign_stmt.target;
+            if (target && target->type != AST_IDENTIFIER) return set_always();
+            return set_union(fc, rate_count_need(fc, target),
+                             rate_count_need(fc, stmt->data.assign_stmt.value));
+        case AST_BINARY_EXPR:
+            if (stmt->data.binary_expr.op >= OP_ADD_ASSIGN &&
+                stmt->data.binary_expr.op <= OP_RSHIFT_ASSIGN) {
+                target = stmt->data.binary_expr.left;
+            }
+            break;
+        case AST_UNARY_EXPR:
+            if (stmt->data.unary_expr.op == OP_INC || stmt->data.unary_expr.op == OP_DEC) {
+                target = stmt->data.unary_expr.operand;
+            }
+            break;
+        case AST_RETURN_STMT:
+            return set_never();
+        default:
+            break;
+    }
+    if (target && target->type != AST_IDENTIFIER) return set_always();
+    return rate_count_need(fc, stmt);
+}
+
+// 遍历语句块, 返回块内所有动作 (非 continue 的返回或有副作用的语句) 的条件并集
+// path 为到达当前语句的必要条件, terminated 表示语句块总以 return 结束
+static feature_set_t walk_block(filter_ctx_t* fc, const ast_list_t* stmts,
+                                feature_set_t path, int* terminated) {
+    feature_set_t acc = set_never();
+    *terminated = 0;
+
+    for (; stmts; stmts = stmts->next) {
+        const ast_node_t* stmt = stmts->node;
+        if (!stmt) continue;
+
+        feature_set_t effect = side_effect_need(fc, stmt);
+        if (!set_is_never(effect)) {
+            acc = set_union(fc, acc, set_pick(path, effect));
+        }
+
+        switch (stmt->type) {
+            case AST_RETURN_STMT:
+                if (stmt->data.return_stmt.type != RETURN_CONTINUE) {
+                    acc = set_union(fc, acc, path);
+                }
+                *terminated = 1;
+                return acc;
+
+            case AST_IF_STMT: {
+                const ast_node_t* cond = stmt->data.if_stmt.condition;
+                feature_set_t then_path = set_pick(path, condition_need(fc, cond, 1));
+                feature_set_t else_path = set_pick(path, condition_need(fc, cond, 0));
+                int then_done = 0, else_done = 0;
+
+                acc = set_union(fc, acc, walk_block(fc, stmt->data.if_stmt.then_body,
+                                                    then_path, &then_done));
+                acc = set_union(fc, acc, walk_block(fc, stmt->data.if_stmt.else_body,
+                                                    else_path, &else_done));
+                if (then_done && else_done) {
+                    *terminated = 1;
+                    return acc;
+                }
+                // if c { return ... } 之后的语句只有在 c 为假时才会执行
+                if (then_done) path = else_path;
+                if (else_done) path = then_path;
+                break;
+            }
+
+            case AST_WHILE_STMT: {
+                int done = 0;
+                feature_set_t body_path = set_pick(path,
+                    condition_need(fc, stmt->data.while_stmt.condition, 1));
+                acc = set_union(fc, acc, walk_block(fc, stmt->data.while_stmt.body,
+                                                    body_path, &done));
+                break;
+            }
+
+            case AST_FOR_STMT: {
+                int done = 0;
+                acc = set_union(fc, acc, walk_block(fc, stmt->data.for_stmt.body, path, &done));
+                break;
+            }
+
+            default:
+                break;
+        }
+    }
+    return acc;
+}
+
+rule_filter_t extract_rule_filter(feature_table_t* table, memory_pool_t* pool,
+                                  const char* global_name, const ast_node_t* rule) {
+    rule_filter_t filter = {1, 0, NULL};
+    filter_ctx_t fc;
+    fc.table = table;
+    fc.scratch = create_pool(POOL_SIZE);
+    fc.global_name = global_name;
+    fc.rule = rule;
+    if (!fc.scratch) return filter;
+
+    int terminated = 0;
+    feature_set_t need = walk_block(&fc, rule->data.rule.body, set_always(), &terminated);
+
+    filter.always = need.always;
+    if (!need.always && need.count > 0) {
+        filter.features = palloc(pool, sizeof(int) * need.count);
+        if (filter.features) {
+            memcpy(filter.features, need.ids, sizeof(int) * need.count);
+            filter.count = need.count;
+        } else {
+            filter.always = 1;
+        }
+    }
+
+    destroy_pool(fc.scratch);
+    return filter;
+}
+
+static int compare_ids(const void* a, const void* b) {
+    int x = *(const int*)a, y = *(const int*)b;
+    return (x > y) - (x < y);
+}
+
+// 在升序的 feature_ids 中二分查找
+static int find_feature(const prefilter_index_t* index, int id) {
+    int lo = 0, hi = index->feature_count;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (index->feature_ids[mid] < id) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo < index->feature_count && index->feature_ids[lo] == id ? lo : -1;
+}
+
+int build_prefilter_index(prefilter_index_t* index, memory_pool_t* pool,
+                          const rule_filter_t* filters, int rule_count) {
+    memset(index, 0, sizeof(*index));
+    index->rule_count = rule_count;
+    index->word_count = (rule_count + 63) / 64;
+
+    int total = 0;
+    for (int r = 0; r < rule_count; r++) {
+        if (!filters[r].always) total += filters[r].count;
+    }
+
+    index->always = palloc(pool, sizeof(uint64_t) * (index->word_count + 1));
+    index->feature_ids = palloc(pool, sizeof(int) * (total + 1));
+    index->postings = palloc(pool, sizeof(int) * (total + 1));
+    if (!index->always || !index->feature_ids || !index->postings) return -1;
+    memset(index->always, 0, sizeof(uint64_t) * (index->word_count + 1));
+
+    // 用到的特征去重排序
+    int n = 0;
+    for (int r = 0; r < rule_count; r++) {
+        if (filters[r].always) {
+            index->always[r >> 6] |= 1ULL << (r & 63);
+            continue;
+        }
+        for (int i = 0; i < filters[r].count; i++) {
+            index->feature_ids[n++] = filters[r].features[i];
+        }
+    }
+    qsort(index->feature_ids, n, sizeof(int), compare_ids);
+    int unique = 0;
+    for (int i = 0; i < n; i++) {
+        if (unique == 0 || index->feature_ids[unique - 1] != index->feature_ids[i]) {
+            index->feature_ids[unique++] = index->feature_ids[i];
+        }
+    }
+    index->feature_count = unique;
+
+    index->posting_offsets = palloc(pool, sizeof(int) * (unique + 1));
+    int* fill = malloc(sizeof(int) * (unique + 1));
+    if (!index->posting_offsets || !fill) {
+        free(fill);
+        return -1;
+    }
+    memset(index->posting_offsets, 0, sizeof(int) * (unique + 1));
+    for (int r = 0; r < rule_count; r++) {
+        if (filters[r].always) continue;
+        for (int i = 0; i < filters[r].count; i++) {
+            index->posting_offsets[find_feature(index, filters[r].features[i]) + 1]++;
+        }
+    }
+    for (int k = 0; k < unique; k++) {
+        index->posting_offsets[k + 1] += index->posting_offsets[k];
+    }
+
+    // 按规则序号顺序填充, 保证倒排表有序
+    memcpy(fill, index->posting_offsets, sizeof(int) * (unique + 1));
+    for (int r = 0; r < rule_count; r++) {
+        if (filters[r].always) continue;
+        for (int i = 0; i < filters[r].count; i++) {
+            index->postings[fill[find_feature(index, filters[r].features[i])]++] = r;
+        }
+    }
+    free(fill);
+    return 0;
+}
+
+// 选出候选规则, 按执行顺序写入 out, 返回数量
+// scratch 至少 word_count 个字, 调用前后均为全零
+int prefilter_select(const prefilter_index_t* index, const presence_set_t* present,
+                     uint64_t* scratch, int* out) {
+    for (int i = 0; i < present->count; i++) {
+        int k = find_feature(index, present->ids[i]);
+        if (k < 0) continue;
+
+        for (int p = index->posting_offsets[k]; p < index->posting_offsets[k + 1]; p++) {
+            int r = index->postings[p];
+            scratch[r >> 6] |= 1ULL << (r & 63);
+        }
+    }
+
+    int count = 0;
+    for (int w = 0; w < index->word_count; w++) {
+        uint64_t bits = scratch[w] | index->always[w];
+        scratch[w] = 0;
+        while (bits) {
+            out[count++] = w * 64 + __builtin_ctzll(bits);
+            bits &= bits - 1;
+        }
+    }
+    return count;
+}
+
+presence_set_t* create_presence_set(memory_pool_t* pool, int capacity) {
+    presence_set_t* set = palloc(pool, sizeof(presence_set_t));
+    if (!set) return NULL;
+
+    set->ids = palloc(pool, sizeof(int) * (capacity + 1));
+    if (!set->ids) return NULL;
+    set->count = 0;
+    set->capacity = capacity;
+    return set;
+}
+
+void presence_set_clear(presence_set_t* set) {
+    set->count = 0;
+}
+
+void presence_set_add(presence_set_t* set, int id) {
+    if (id < 0 || set->count >= set->capacity) return;
+    set->ids[set->count++] = id;
+}
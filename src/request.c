@@ -0,0 +1,118 @@
+#include <string.h>
+#include "request.h"
+
+request_t* create_request(const type_t* type) {
+    memory_pool_t* pool = create_pool(POOL_SIZE);
+    if (!pool) return NULL;
+
+    request_t* request = palloc(pool, sizeof(request_t));
+    if (!request) {
+        destroy_pool(pool);
+        return NULL;
+    }
+
+    int count = type ? type->field_count : 0;
+    request->type = type;
+    request->pool = pool;
+    request->arena = create_pool(POOL_SIZE);
+    request->fields = palloc(pool, sizeof(value_t) * (count + 1));
+    request->self.object.tag = VALUE_STRUCT;
+    request->self.object.ptr = request;
+    request->keywords = NULL;
+    if (!request->arena || !request->fields) {
+        destroy_request(request);
+        return NULL;
+    }
+
+    request_reset(request);
+    return request;
+}
+
+void destroy_request(request_t* request) {
+    if (request) {
+        destroy_pool(request->arena);
+        destroy_pool(request->pool);
+    }
+}
+
+// 清空上一次请求的数据, arena 的内存块保留复用, 稳定状态下不再申请堆内存
+void request_reset(request_t* request) {
+    reset_pool(request->arena);
+    int count = request->type ? request->type->field_count : 0;
+    for (int i = 0; i < count; i++) {
+        request->fields[i] = value_zero(request->type->fields[i].type);
+    }
+    request->keywords = NULL;
+}
+
+int request_field_index(const request_t* request, const char* name) {
+    return struct_field_index(request->type, name);
+}
+
+void request_set_field(request_t* request, int field, value_t value) {
+    if (request->type && field >= 0 && field < request->type->field_count) {
+        request->fields[field] = value;
+    }
+}
+
+void request_set_keywords(request_t* request, const value_map_t* keywords) {
+    request->keywords = keywords;
+}
+
+static int is_space(char c) {
+    return c == ' ' || c == '\t';
+}
+
+// 去掉两侧空白, 不复制
+static value_t trimmed_view(const char* start, const char* end) {
+    while (start < end && is_space(*start)) start++;
+    while (end > start && (is_space(end[-1]) || end[-1] == '\r')) end--;
+    return value_view(start, end - start);
+}
+
+static int count_char(const char* buf, size_t len, char c) {
+    int n = 0;
+    for (const char* p = buf; (p = memchr(p, c, buf + len - p)) != NULL; p++) {
+        n++;
+    }
+    return n;
+}
+
+value_map_t* request_parse_headers(request_t* request, const char* buf, size_t len) {
+    value_map_t* map = create_value_map(request->arena, count_char(buf, len, '\n') + 1);
+    if (!map) return NULL;
+
+    const char* end = buf + len;
+    for (const char* line = buf; line < end; ) {
+        const char* eol = memchr(line, '\n', end - line);
+        if (!eol) eol = end;
+
+        const char* colon = memchr(line, ':', eol - line);
+        if (colon && colon > line) {
+            value_map_put(map, trimmed_view(line, colon), trimmed_view(colon + 1, eol));
+        }
+        line = eol + 1;
+    }
+    return map;
+}
+
+value_map_t* request_parse_params(request_t* request, const char* buf, size_t len) {
+    value_map_t* map = create_value_map(request->arena, count_char(buf, len, '&') + 1);
+    if (!map) return NULL;
+
+    const char* end = buf + len;
+    for (const char* item = buf; item < end; ) {
+        const char* amp = memchr(item, '&', end - item);
+        if (!amp) amp = end;
+
+        const char* eq = memchr(item, '=', amp - item);
+        const char* key_end = eq ? eq : amp;
+        if (key_end > item) {
+            value_t key = trimmed_view(item, key_end);
+            value_t value = eq ? trimmed_view(eq + 1, amp) : value_view(amp, 0);
+            value_map_put(map, key, value);
+        }
+        item = amp + 1;
+    }
+    return map;
+}
@@ -0,0 +1,734 @@
+#include <stdio.h>
+#include <string.h>
+#include "ruleset.h"
+#include "checker.h"
+#include "hash.h"
+#include "types.h"
+
+extern FILE* yyin;
+extern int yylineno;
+extern int yyparse(parser_context_t* ctx);
+
+// 规范化内容缓冲区, 用于计算内容哈希和精确比较
+typedef struct key_buffer {
+    char* data;
+    size_t len;
+    size_t cap;
+    int failed;
+} key_buffer_t;
+
+static void put_bytes(key_buffer_t* kb, const void* p, size_t n) {
+    if (kb->failed) return;
+    if (kb->len + n > kb->cap) {
+        size_t cap = kb->cap ? kb->cap * 2 : 1024;
+        while (cap < kb->len + n) cap *= 2;
+        char* data = realloc(kb->data, cap);
+        if (!data) {
+            kb->failed = 1;
+            return;
+        }
+        kb->data = data;
+        kb->cap = cap;
+    }
+    memcpy(kb->data + kb->len, p, n);
+    kb->len += n;
+}
+
+static void put_int(key_buffer_t* kb, int64_t v) {
+    put_bytes(kb, &v, sizeof(v));
+}
+
+static void put_str(key_buffer_t* kb, const char* s) {
+    if (!s) {
+        put_int(kb, -1);
+        return;
+    }
+    size_t len = strlen(s);
+    put_int(kb, (int64_t)len);
+    put_bytes(kb, s, len);
+}
+
+static void put_node(key_buffer_t* kb, const ast_node_t* node);
+
+static void put_list(key_buffer_t* kb, const ast_list_t* list) {
+    int64_t n = 0;
+    for (const ast_list_t* l = list; l; l = l->next) n++;
+    put_int(kb, n);
+    for (; list; list = list->next) {
+        put_node(kb, list->node);
+    }
+}
+
+// 行号不参与比较, 内容相同的命名空间在不同文件中的位置可以不同
+static void put_node(key_buffer_t* kb, const ast_node_t* node) {
+    if (!node) {
+        put_int(kb, -1);
+        return;
+    }
+    put_int(kb, node->type);
+
+    switch (node->type) {
+        case AST_NAMESPACE:
+            put_str(kb, node->data.namespace.name);
+            put_list(kb, node->data.namespace.rules);
+            break;
+        case AST_RULE:
+            put_str(kb, node->data.rule.name);
+            put_list(kb, node->data.rule.body);
+            put_list(kb, node->data.rule.after_rules);
+            put_list(kb, node->data.rule.before_rules);
+            break;
+        case AST_LET_STMT:
+            put_str(kb, node->data.let_stmt.name);
+            put_node(kb, node->data.let_stmt.init);
+            break;
+        case AST_IF_STMT:
+            put_node(kb, node->data.if_stmt.condition);
+            put_list(kb, node->data.if_stmt.then_body);
+            put_list(kb, node->data.if_stmt.else_body);
+            break;
+        case AST_FOR_STMT:
+            put_str(kb, node->data.for_stmt.iterator);
+            put_node(kb, node->data.for_stmt.range);
+            put_list(kb, node->data.for_stmt.body);
+            break;
+        case AST_WHILE_STMT:
+            put_node(kb, node->data.while_stmt.condition);
+            put_list(kb, node->data.while_stmt.body);
+            break;
+        case AST_RETURN_STMT:
+            put_int(kb, node->data.return_stmt.type);
+            break;
+        case AST_ASSIGN_STMT:
+            put_node(kb, node->data.assign_stmt.target);
+            put_node(kb, node->data.assign_stmt.value);
+            break;
+        case AST_FUNC_CALL:
+            put_str(kb, node->data.func_call.name);
+            put_list(kb, node->data.func_call.args);
+            break;
+        case AST_MAP_ACCESS:
+            put_node(kb, node->data.map_access.target);
+            put_node(kb, node->data.map_access.key);
+            break;
+        case AST_MEMBER_ACCESS:
+            put_node(kb, node->data.member_access.target);
+            put_str(kb, node->data.member_access.member);
+            break;
+        case AST_BINARY_EXPR:
+            put_int(kb, node->data.binary_expr.op);
+            put_node(kb, node->data.binary_expr.left);
+            put_node(kb, node->data.binary_expr.right);
+            break;
+        case AST_UNARY_EXPR:
+            put_int(kb, node->data.unary_expr.op);
+            put_node(kb, node->data.unary_expr.operand);
+            break;
+        case AST_IDENTIFIER:
+            put_str(kb, node->data.identifier.name);
+            break;
+        case AST_STRING_LITERAL:
+            put_int(kb, (int64_t)node->data.string_literal.length);
+            put_bytes(kb, node->data.string_literal.value, node->data.string_literal.length);
+            break;
+        case AST_INTEGER_LITERAL:
+            put_int(kb, node->data.integer_literal.value);
+            break;
+        case AST_FLOAT_LITERAL:
+            put_bytes(kb, &node->data.float_literal.value, sizeof(double));
+            break;
+        case AST_ARRAY_LITERAL:
+            put_list(kb, node->data.array_literal.items);
+            break;
+        default:
+            break;
+    }
+}
+
+// 全局结构体定义决定成员序号, 是命名空间编译结果的一部分
+static void put_global(key_buffer_t* kb, const ast_node_t* global) {
+    if (!global) {
+        put_int(kb, -1);
+        return;
+    }
+    put_str(kb, global->data.global.name);
+    for (const ast_list_t* m = global->data.global.members; m; m = m->next) {
+        if (!m->node) continue;
+        put_str(kb, m->node->data.struct_member.name);
+        put_str(kb, m->node->data.struct_member.type);
+    }
+}
+
+// AST 复制: 命名空间的 AST 复制到自己的内存池, 加载用的解析器上下文随即释放
+typedef struct type_copy {
+    const type_t* from;
+    const type_t* to;
+    struct type_copy* next;
+} type_copy_t;
+
+typedef struct cloner {
+    memory_pool_t* pool;
+    type_copy_t* types;
+    int failed;
+} cloner_t;
+
+static char* clone_str(cloner_t* cl, const char* s) {
+    if (!s) return NULL;
+    char* copy = pstrdup(cl->pool, s);
+    if (!copy) cl->failed = 1;
+    return copy;
+}
+
+static const type_t* clone_type(cloner_t* cl, const type_t* t) {
+    if (!t || t == &type_nil || t == &type_int || t == &type_float || t == &type_string) {
+        return t;
+    }
+    for (type_copy_t* c = cl->types; c; c = c->next) {
+        if (c->from == t) return c->to;
+    }
+
+    type_t* copy = palloc(cl->pool, sizeof(type_t));
+    type_copy_t* record = palloc(cl->pool, sizeof(type_copy_t));
+    if (!copy || !record) {
+        cl->failed = 1;
+        return NULL;
+    }
+    *copy = *t;
+    record->from = t;
+    record->to = copy;
+    record->next = cl->types;
+    cl->types = record;
+
+    copy->key = clone_type(cl, t->key);
+    copy->elem = clone_type(cl, t->elem);
+    copy->name = clone_str(cl, t->name);
+    if (t->fields) {
+        copy->fields = palloc(cl->pool, sizeof(struct_field_t) * (t->field_count + 1));
+        if (!copy->fields) {
+            cl->failed = 1;
+            return NULL;
+        }
+        for (int i = 0; i < t->field_count; i++) {
+            copy->fields[i].name = clone_str(cl, t->fields[i].name);
+            copy->fields[i].type = clone_type(cl, t->fields[i].type);
+        }
+    }
+    return copy;
+}
+
+static ast_node_t* clone_node(cloner_t* cl, const ast_node_t* node);
+
+static ast_list_t* clone_list(cloner_t* cl, const ast_list_t* list) {
+    ast_list_t* head = NULL;
+    ast_list_t** tail = &head;
+    for (; list; list = list->next) {
+        ast_list_t* item = palloc(cl->pool, sizeof(ast_list_t));
+        if (!item) {
+            cl->failed = 1;
+            return head;
+        }
+        item->node = clone_node(cl, list->node);
+        item->next = NULL;
+        *tail = item;
+        tail = &item->next;
+    }
+    return head;
+}
+
+static ast_node_t* clone_node(cloner_t* cl, const ast_node_t* node) {
+    if (!node) return NULL;
+
+    ast_node_t* copy = palloc(cl->pool, sizeof(ast_node_t));
+    if (!copy) {
+        cl->failed = 1;
+        return NULL;
+    }
+    *copy = *node;
+    copy->value_type = clone_type(cl, node->value_type);
+
+    switch (node->type) {
+        case AST_NAMESPACE:
+            copy->data.namespace.name = clone_str(cl, node->data.namespace.name);
+            copy->data.namespace.rules = clone_list(cl, node->data.namespace.rules);
+            break;
+        case AST_RULE:
+            copy->data.rule.name = clone_str(cl, node->data.rule.name);
+            copy->data.rule.body = clone_list(cl, node->data.rule.body);
+            copy->data.rule.after_rules = clone_list(cl, node->data.rule.after_rules);
+            copy->data.rule.before_rules = clone_list(cl, node->data.rule.before_rules);
+            break;
+        case AST_LET_STMT:
+            copy->data.let_stmt.name = clone_str(cl, node->data.let_stmt.name);
+            copy->data.let_stmt.init = clone_node(cl, node->data.let_stmt.init);
+            break;
+        case AST_IF_STMT:
+            copy->data.if_stmt.condition = clone_node(cl, node->data.if_stmt.condition);
+            copy->data.if_stmt.then_body = clone_list(cl, node->data.if_stmt.then_body);
+            copy->data.if_stmt.else_body = clone_list(cl, node->data.if_stmt.else_body);
+            break;
+        case AST_FOR_STMT:
+            copy->data.for_stmt.iterator = clone_str(cl, node->data.for_stmt.iterator);
+            copy->data.for_stmt.range = clone_node(cl, node->data.for_stmt.range);
+            copy->data.for_stmt.body = clone_list(cl, node->data.for_stmt.body);
+            break;
+        case AST_WHILE_STMT:
+            copy->data.while_stmt.condition = clone_node(cl, node->data.while_stmt.condition);
+            copy->data.while_stmt.body = clone_list(cl, node->data.while_stmt.body);
+            break;
+        case AST_ASSIGN_STMT:
+            copy->data.assign_stmt.target = clone_node(cl, node->data.assign_stmt.target);
+            copy->data.assign_stmt.value = clone_node(cl, node->data.assign_stmt.value);
+            break;
+        case AST_FUNC_CALL:
+            copy->data.func_call.name = clone_str(cl, node->data.func_call.name);
+            copy->data.func_call.args = clone_list(cl, node->data.func_call.args);
+            break;
+        case AST_MAP_ACCESS:
+            copy->data.map_access.target = clone_node(cl, node->data.map_access.target);
+            copy->data.map_access.key = clone_node(cl, node->data.map_access.key);
+            break;
+        case AST_MEMBER_ACCESS:
+            copy->data.member_access.target = clone_node(cl, node->data.member_access.target);
+            copy->data.member_access.member = clone_str(cl, node->data.member_access.member);
+            break;
+        case AST_BINARY_EXPR:
+            copy->data.binary_expr.left = clone_node(cl, node->data.binary_expr.left);
+            copy->data.binary_expr.right = clone_node(cl, node->data.binary_expr.right);
+            if (node->data.binary_expr.set) {
+                // 常量集合引用字面量, 需要基于复制后的字面量重建
+                copy->data.binary_expr.set = compile_const_set(cl->pool,
+                                                               copy->data.binary_expr.right);
+                if (!copy->data.binary_expr.set) cl->failed = 1;
+            }
+            break;
+        case AST_UNARY_EXPR:
+            copy->data.unary_expr.operand = clone_node(cl, node->data.unary_expr.operand);
+            break;
+        case AST_IDENTIFIER:
+            copy->data.identifier.name = clone_str(cl, node->data.identifier.name);
+            break;
+        case AST_STRING_LITERAL: {
+            size_t len = node->data.string_literal.length;
+            char* value = palloc(cl->pool, len + 1);
+            if (!value) {
+                cl->failed = 1;
+                break;
+            }
+            memcpy(value, node->data.string_literal.value, len + 1);
+            copy->data.string_literal.value = value;
+            break;
+        }
+        case AST_ARRAY_LITERAL:
+            copy->data.array_literal.items = clone_list(cl, node->data.array_literal.items);
+            break;
+        default:
+            break;
+    }
+    return copy;
+}
+
+static void link_namespace(ruleset_registry_t* registry, compiled_namespace_t* ns) {
+    compiled_namespace_t** bucket = &registry->buckets[ns->hash % REGISTRY_BUCKETS];
+    ns->next = *bucket;
+    *bucket = ns;
+    registry->namespace_count++;
+}
+
+static void unlink_namespace(ruleset_registry_t* registry, compiled_namespace_t* ns) {
+    compiled_namespace_t** p = &registry->buckets[ns->hash % REGISTRY_BUCKETS];
+    for (; *p; p = &(*p)->next) {
+        if (*p == ns) {
+            *p = ns->next;
+            registry->namespace_count--;
+            return;
+        }
+    }
+}
+
+static compiled_namespace_t* alloc_namespace(const char* name, size_t pool_size) {
+    memory_pool_t* pool = create_pool(pool_size);
+    if (!pool) return NULL;
+
+    compiled_namespace_t* ns = palloc_aligned(pool, sizeof(compiled_namespace_t),
+                                              _Alignof(compiled_namespace_t));
+    if (!ns) {
+        destroy_pool(pool);
+        return NULL;
+    }
+    memset(ns, 0, sizeof(*ns));
+    ns->pool = pool;
+    ns->name = pstrdup(pool, name);
+    ns->refcount = 1;
+    return ns;
+}
+
+static int collect_rule_nodes(const ast_node_t* ns_node, const ast_node_t*** out) {
+    int n = 0;
+    for (const ast_list_t* r = ns_node->data.namespace.rules; r; r = r->next) {
+        if (r->node) n++;
+    }
+    *out = malloc(sizeof(ast_node_t*) * (n + 1));
+    if (!*out) return -1;
+
+    n = 0;
+    for (const ast_list_t* r = ns_node->data.namespace.rules; r; r = r->next) {
+        if (r->node) (*out)[n++] = r->node;
+    }
+    return n;
+}
+
+// 查找或编译一个命名空间, 返回的命名空间已持有一个引用
+static compiled_namespace_t* intern_namespace(ruleset_registry_t* registry,
+                                              const ast_node_t* global,
+                                              const ast_node_t* ns_node) {
+    key_buffer_t kb = {NULL, 0, 0, 0};
+    put_global(&kb, global);
+    put_node(&kb, ns_node);
+    if (kb.failed) {
+        free(kb.data);
+        return NULL;
+    }
+
+    uint64_t hash = fnv1a_64(FNV64_OFFSET, kb.data, kb.len);
+    for (compiled_namespace_t* e = registry->buckets[hash % REGISTRY_BUCKETS]; e; e = e->next) {
+        if (e->hash == hash && !e->base && e->key_len == kb.len &&
+            memcmp(e->key, kb.data, kb.len) == 0) {
+            free(kb.data);
+            acquire_namespace(e);
+            return e;
+        }
+    }
+
+    compiled_namespace_t* ns = alloc_namespace(ns_node->data.namespace.name, POOL_SIZE);
+    if (!ns) {
+        free(kb.data);
+        return NULL;
+    }
+    ns->hash = hash;
+    ns->key_len = kb.len;
+    char* key = palloc(ns->pool, kb.len);
+    if (key) memcpy(key, kb.data, kb.len);
+    ns->key = key;
+    free(kb.data);
+
+    cloner_t cl = {ns->pool, NULL, 0};
+    const ast_node_t* copy = clone_node(&cl, ns_node);
+    ns->global_type = global ? clone_type(&cl, global->value_type) : NULL;
+
+    const ast_node_t** rules = NULL;
+    int n = (!cl.failed && key) ? collect_rule_nodes(copy, &rules) : -1;
+    int ok = n >= 0 && compile_namespace_rules(ns, rules, n, &registry->features,
+                                               global ? global->data.global.name : NULL) == 0;
+    free(rules);
+    if (!ok) {
+        destroy_pool(ns->pool);
+        return NULL;
+    }
+
+    link_namespace(registry, ns);
+    return ns;
+}
+
+// 合并同名命名空间: overlay 中的同名规则替换 base 中的规则, 两侧的 after/before
+// 按合并后的规则解析. 合并结果叠加在 base 与 overlay 已编译的规则和索引之上,
+// 只保存替换表和位置表, 大小与 overlay 的规则数成正比, 与 base 的规则数无关
+static compiled_namespace_t* merge_namespace(ruleset_registry_t* registry,
+                                             compiled_namespace_t* base,
+                                             compiled_namespace_t* overlay) {
+    uint64_t hash = fnv1a_64(base->hash, &overlay->hash, sizeof(overlay->hash));
+    for (compiled_namespace_t* e = registry->buckets[hash % REGISTRY_BUCKETS]; e; e = e->next) {
+        if (e->hash == hash && e->base == base && e->overlay == overlay) {
+            acquire_namespace(e);
+            return e;
+        }
+    }
+
+    int overlay_count = overlay->rule_count;
+    size_t size = sizeof(compiled_namespace_t) + CACHE_LINE_SIZE + strlen(base->name) + 1 +
+                  sizeof(int) * 5 * (overlay_count + 1) + 64;
+    compiled_namespace_t* ns = alloc_namespace(base->name, size);
+    if (!ns) return NULL;
+
+    ns->base = base;
+    ns->overlay = overlay;
+    if (compile_merged_rules(ns) != 0) {
+        destroy_pool(ns->pool);
+        return NULL;
+    }
+
+    ns->hash = hash;
+    ns->global_type = overlay->global_type;
+    ns->max_slots = base->max_slots > overlay->max_slots ? base->max_slots : overlay->max_slots;
+
+    acquire_namespace(base);
+    acquire_namespace(overlay);
+    link_namespace(registry, ns);
+    return ns;
+}
+
+ruleset_registry_t* create_ruleset_registry(void) {
+    memory_pool_t* pool = create_pool(POOL_SIZE);
+    if (!pool) return NULL;
+
+    ruleset_registry_t* registry = palloc(pool, sizeof(ruleset_registry_t));
+    if (!registry) {
+        destroy_pool(pool);
+        return NULL;
+    }
+    memset(registry, 0, sizeof(*registry));
+    registry->pool = pool;
+    init_feature_table(&registry->features, pool);
+    return registry;
+}
+
+void destroy_ruleset_registry(ruleset_registry_t* registry) {
+    if (!registry) return;
+
+    for (int b = 0; b < REGISTRY_BUCKETS; b++) {
+        compiled_namespace_t* ns = registry->buckets[b];
+        while (ns) {
+            compiled_namespace_t* next = ns->next;
+            destroy_pool(ns->pool);
+            ns = next;
+        }
+    }
+    release_feature_snapshot(registry, registry->snapshot);
+    destroy_pool(registry->pool);
+}
+
+size_t registry_memory(const ruleset_registry_t* registry) {
+    size_t size = pool_size(registry->pool) + registry->attached_memory;
+    for (int b = 0; b < REGISTRY_BUCKETS; b++) {
+        for (const compiled_namespace_t* ns = registry->buckets[b]; ns; ns = ns->next) {
+            size += pool_size(ns->pool);
+        }
+    }
+    return size;
+}
+
+void acquire_namespace(compiled_namespace_t* ns) {
+    ns->refcount++;
+}
+
+void release_namespace(ruleset_registry_t* registry, compiled_namespace_t* ns) {
+    if (!ns || --ns->refcount > 0) return;
+
+    unlink_namespace(registry, ns);
+    compiled_namespace_t* base = ns->base;
+    compiled_namespace_t* overlay = ns->overlay;
+    destroy_pool(ns->pool);
+    release_namespace(registry, base);
+    release_namespace(registry, overlay);
+}
+
+feature_snapshot_t* acquire_feature_snapshot(ruleset_registry_t* registry) {
+    feature_snapshot_t* snapshot = registry->snapshot;
+    if (!snapshot || snapshot->table.count != registry->features.count) {
+        snapshot = create_feature_snapshot(&registry->features);
+        if (!snapshot) return NULL;
+        registry->attached_memory += pool_size(snapshot->pool);
+        release_feature_snapshot(registry, registry->snapshot);
+        registry->snapshot = snapshot;
+    }
+    snapshot->refcount++;
+    return snapshot;
+}
+
+void release_feature_snapshot(ruleset_registry_t* registry, feature_snapshot_t* snapshot) {
+    if (!snapshot || --snapshot->refcount > 0) return;
+
+    registry->attached_memory -= pool_size(snapshot->pool);
+    destroy_feature_snapshot(snapshot);
+}
+
+// 按加载顺序收集的命名空间, 同名的合并为一个
+typedef struct namespace_list {
+    compiled_namespace_t** items;
+    int count;
+    int capacity;
+    char* global_key;      // 第一个程序的全局结构体定义
+    size_t global_len;
+} namespace_list_t;
+
+static void release_list(ruleset_registry_t* registry, namespace_list_t* list) {
+    for (int i = 0; i < list->count; i++) {
+        release_namespace(registry, list->items[i]);
+    }
+    free(list->items);
+    free(list->global_key);
+    list->items = NULL;
+    list->count = 0;
+}
+
+static int append_namespace(ruleset_registry_t* registry, namespace_list_t* list,
+                            compiled_namespace_t* ns) {
+    for (int i = 0; i < list->count; i++) {
+        if (strcmp(list->items[i]->name, ns->name) != 0) continue;
+
+        compiled_namespace_t* merged = merge_namespace(registry, list->items[i], ns);
+        if (!merged) return -1;
+        release_namespace(registry, list->items[i]);
+        release_namespace(registry, ns);
+        list->items[i] = merged;
+        return 0;
+    }
+
+    if (list->count == list->capacity) {
+        int capacity = list->capacity ? list->capacity * 2 : 8;
+        compiled_namespace_t** items = realloc(list->items, sizeof(*items) * capacity);
+        if (!items) return -1;
+        list->items = items;
+        list->capacity = capacity;
+    }
+    list->items[list->count++] = ns;
+    return 0;
+}
+
+// 命名空间列表已合并完成, 检查 after/before 引用, 共享的命名空间只检查一次
+static void check_list(namespace_list_t* list) {
+    for (int i = 0; i < list->count; i++) {
+        compiled_namespace_t* ns = list->items[i];
+        if (ns->references_checked) continue;
+        check_rule_references(ns);
+        ns->references_checked = 1;
+    }
+}
+
+static int add_program(ruleset_registry_t* registry, parser_context_t* ctx,
+                       namespace_list_t* list) {
+    const ast_node_t* global = ctx->root->data.program.global;
+
+    // 同一规则集中的所有程序必须使用相同的全局结构体定义
+    key_buffer_t kb = {NULL, 0, 0, 0};
+    put_global(&kb, global);
+    if (kb.failed) return -1;
+    if (!list->global_key) {
+        list->global_key = kb.data;
+        list->global_len = kb.len;
+    } else {
+        int same = kb.len == list->global_len && memcmp(kb.data, list->global_key, kb.len) == 0;
+        free(kb.data);
+        if (!same) {
+            fprintf(stderr, "Error: global struct in %s differs from the rest of the ruleset\n",
+                    ctx->current_file ? ctx->current_file : "<input>");
+            return -1;
+        }
+    }
+
+    for (const ast_list_t* ns = ctx->root->data.program.namespaces; ns; ns = ns->next) {
+        if (!ns->node) continue;
+        compiled_namespace_t* compiled = intern_namespace(registry, global, ns->node);
+        if (!compiled || append_namespace(registry, list, compiled) != 0) {
+            release_namespace(registry, compiled);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+compiled_namespace_t** registry_add_program(ruleset_registry_t* registry,
+                                            parser_context_t* ctx, int* count) {
+    namespace_list_t list = {NULL, 0, 0, NULL, 0};
+    if (add_program(registry, ctx, &list) != 0) {
+        release_list(registry, &list);
+        return NULL;
+    }
+
+    check_list(&list);
+    free(list.global_key);
+    *count = list.count;
+    return list.items ? list.items : calloc(1, sizeof(compiled_namespace_t*));
+}
+
+// 解析并检查一个规则文件, 失败返回 NULL
+static parser_context_t* parse_rule_file(const char* path) {
+    FILE* input = fopen(path, "r");
+    if (!input) {
+        fprintf(stderr, "Cannot open input file '%s'\n", path);
+        return NULL;
+    }
+
+    parser_context_t* ctx = create_parser_context();
+    if (!ctx) {
+        fclose(input);
+        return NULL;
+    }
+    ctx->current_file = (char*)path;
+    yyin = input;
+    yylineno = 1;
+
+    int result = yyparse(ctx);
+    if (result == 0 && ctx->root) {
+        check_program(ctx);
+    }
+    fclose(input);
+
+    if (result != 0 || !ctx->root || ctx->error_count > 0) {
+        fprintf(stderr, "Error: failed to load '%s'\n", path);
+        destroy_parser_context(ctx);
+        return NULL;
+    }
+    return ctx;
+}
+
+tenant_ruleset_t* load_tenant_ruleset(ruleset_registry_t* registry, const char* name,
+                                      char* const* paths, int path_count) {
+    namespace_list_t list = {NULL, 0, 0, NULL, 0};
+    for (int i = 0; i < path_count; i++) {
+        parser_context_t* ctx = parse_rule_file(paths[i]);
+        int ok = ctx && add_program(registry, ctx, &list) == 0;
+        // 命名空间已复制到注册表, 解析器上下文不再需要
+        destroy_parser_context(ctx);
+        if (!ok) {
+            release_list(registry, &list);
+            return NULL;
+        }
+    }
+    check_list(&list);
+
+    size_t size = sizeof(tenant_ruleset_t) + strlen(name) + 1 +
+                  sizeof(compiled_namespace_t*) * (list.count + 1) + 64;
+    memory_pool_t* pool = create_pool(size);
+    tenant_ruleset_t* tenant = pool ? palloc(pool, sizeof(tenant_ruleset_t)) : NULL;
+    if (!tenant) {
+        destroy_pool(pool);
+        release_list(registry, &list);
+        return NULL;
+    }
+    memset(tenant, 0, sizeof(*tenant));
+    tenant->name = pstrdup(pool, name);
+    tenant->registry = registry;
+    tenant->pool = pool;
+    tenant->namespace_count = list.count;
+    tenant->namespaces = palloc(pool, sizeof(compiled_namespace_t*) * (list.count + 1));
+    if (tenant->namespaces && list.count) {
+        memcpy(tenant->namespaces, list.items, sizeof(compiled_namespace_t*) * list.count);
+    }
+    free(list.items);
+    free(list.global_key);
+
+    // 同一代的租户共享特征表快照, 之后加载其他租户插入的特征不影响本租户的求值
+    tenant->features = acquire_feature_snapshot(registry);
+    tenant->engine = tenant->namespaces && tenant->features ?
+        create_rule_engine_from(tenant->namespaces, tenant->namespace_count,
+                                &tenant->features->table) : NULL;
+    if (!tenant->engine) {
+        destroy_tenant_ruleset(tenant);
+        return NULL;
+    }
+    tenant->memory = pool_size(tenant->pool) + pool_size(tenant->engine->pool);
+    registry->attached_memory += tenant->memory;
+    return tenant;
+}
+
+void destroy_tenant_ruleset(tenant_ruleset_t* tenant) {
+    if (!tenant) return;
+
+    tenant->registry->attached_memory -= tenant->memory;
+    destroy_rule_engine(tenant->engine);
+    for (int i = 0; tenant->namespaces && i < tenant->namespace_count; i++) {
+        release_namespace(tenant->registry, tenant->namespaces[i]);
+    }
+    release_feature_snapshot(tenant->registry, tenant->features);
+    destroy_pool(tenant->pool);
+}
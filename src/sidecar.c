@@ -0,0 +1,153 @@
+#include <string.h>
+#include "sidecar.h"
+
+// 桩服务内部的键值表条目
+struct sidecar_entry {
+    value_t key;
+    int64_t value;
+    sidecar_entry_t* next;
+};
+
+struct sidecar_batch {
+    lookup_t* lookups;
+    int count;
+    void* token;
+    sidecar_batch_t* next;
+};
+
+sidecar_t* create_sidecar(void) {
+    memory_pool_t* pool = create_pool(POOL_SIZE);
+    if (!pool) return NULL;
+
+    sidecar_t* sidecar = palloc(pool, sizeof(sidecar_t));
+    if (!sidecar) {
+        destroy_pool(pool);
+        return NULL;
+    }
+    memset(sidecar, 0, sizeof(*sidecar));
+    sidecar->pool = pool;
+    return sidecar;
+}
+
+void destroy_sidecar(sidecar_t* sidecar) {
+    if (sidecar) {
+        destroy_pool(sidecar->pool);
+    }
+}
+
+// 查找条目, create 为真时不存在则以 0 创建
+static sidecar_entry_t* find_entry(sidecar_t* sidecar, sidecar_entry_t** buckets,
+                                   const value_t* key, int create) {
+    uint32_t h = value_hash(key) % SIDECAR_BUCKETS;
+    for (sidecar_entry_t* e = buckets[h]; e; e = e->next) {
+        if (value_key_equal(&e->key, key)) return e;
+    }
+    if (!create) return NULL;
+
+    sidecar_entry_t* e = palloc(sidecar->pool, sizeof(sidecar_entry_t));
+    if (!e) return NULL;
+    e->key = value_string(sidecar->pool, value_str_data(key), value_str_len(key));
+    e->value = 0;
+    e->next = buckets[h];
+    buckets[h] = e;
+    return e;
+}
+
+void sidecar_set_reputation(sidecar_t* sidecar, const char* ip, int64_t score) {
+    value_t key = value_view(ip, strlen(ip));
+    sidecar_entry_t* e = find_entry(sidecar, sidecar->reputation, &key, 1);
+    if (e) e->value = score;
+}
+
+int sidecar_submit(sidecar_t* sidecar, lookup_t* lookups, int count, void* token) {
+    sidecar_batch_t* batch = sidecar->free_list;
+    if (batch) {
+        sidecar->free_list = batch->next;
+    } else {
+        batch = palloc(sidecar->pool, sizeof(sidecar_batch_t));
+        if (!batch) return -1;
+    }
+
+    batch->lookups = lookups;
+    batch->count = count;
+    batch->token = token;
+    batch->next = NULL;
+    if (sidecar->tail) {
+        sidecar->tail->next = batch;
+    } else {
+        sidecar->head = batch;
+    }
+    sidecar->tail = batch;
+    sidecar->round_trips++;
+    return 0;
+}
+
+static void answer(sidecar_t* sidecar, lookup_t* lookup) {
+    sidecar_entry_t* e;
+
+    if (!value_is_string(&lookup->key)) {
+        lookup->state = LOOKUP_FAILED;
+        return;
+    }
+
+    switch (lookup->kind) {
+        case LOOKUP_IP_REPUTATION:
+            e = find_entry(sidecar, sidecar->reputation, &lookup->key, 0);
+            lookup->result = e ? e->value : 0;
+            lookup->state = LOOKUP_DONE;
+            break;
+        case LOOKUP_RATE_COUNT:
+            e = find_entry(sidecar, sidecar->counters, &lookup->key, 1);
+            if (!e) {
+                lookup->state = LOOKUP_FAILED;
+                break;
+            }
+            lookup->result = ++e->value;
+            lookup->state = LOOKUP_DONE;
+            break;
+        default:
+            lookup->state = LOOKUP_FAILED;
+            break;
+    }
+}
+
+// 完成一个已从队列中摘下的批次, 批次放回空闲链表
+static void* finish_batch(sidecar_t* sidecar, sidecar_batch_t* batch) {
+    for (int i = 0; i < batch->count; i++) {
+        if (batch->lookups[i].state == LOOKUP_PENDING) {
+            answer(sidecar, &batch->lookups[i]);
+            sidecar->lookups++;
+        }
+    }
+
+    void* token = batch->token;
+    batch->next = sidecar->free_list;
+    sidecar->free_list = batch;
+    return token;
+}
+
+void* sidecar_poll(sidecar_t* sidecar) {
+    sidecar_batch_t* batch = sidecar->head;
+    if (!batch) return NULL;
+
+    sidecar->head = batch->next;
+    if (!sidecar->head) sidecar->tail = NULL;
+    return finish_batch(sidecar, batch);
+}
+
+int sidecar_complete(sidecar_t* sidecar, void* token) {
+    sidecar_batch_t* prev = NULL;
+    for (sidecar_batch_t* batch = sidecar->head; batch; prev = batch, batch = batch->next) {
+        if (batch->token != token) continue;
+
+        if (prev) {
+            prev->next = batch->next;
+        } else {
+            sidecar->head = batch->next;
+        }
+        if (sidecar->tail == batch) sidecar->tail = prev;
+        finish_batch(sidecar, batch);
+        return 0;
+    }
+    return -1;
+}
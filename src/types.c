@@ -0,0 +1,150 @@
+#include <stdio.h>
+#include <string.h>
+#include "types.h"
+
+const type_t type_nil = {TYPE_NIL, NULL, NULL, NULL, NULL, 0};
+const type_t type_int = {TYPE_INT, NULL, NULL, NULL, NULL, 0};
+const type_t type_float = {TYPE_FLOAT, NULL, NULL, NULL, NULL, 0};
+const type_t type_string = {TYPE_STRING, NULL, NULL, NULL, NULL, 0};
+
+// 内置函数签名表
+static const builtin_info_t builtins[] = {
+    {BUILTIN_MATCH_KEYWORD, "match_keyword", 1,
+     {&type_string}, &type_int},
+    {BUILTIN_MATCH_KEYWORD_VALUE, "match_keyword_value", 2,
+     {&type_string, &type_string}, &type_int},
+    {BUILTIN_IP_REPUTATION, "ip_reputation", 1,
+     {&type_string}, &type_int},
+    {BUILTIN_RATE_COUNT, "rate_count", 1,
+     {&type_string}, &type_int},
+};
+
+const builtin_info_t* find_builtin(const char* name) {
+    for (size_t i = 0; i < sizeof(builtins) / sizeof(builtins[0]); i++) {
+        if (strcmp(builtins[i].name, name) == 0) {
+            return &builtins[i];
+        }
+    }
+    return NULL;
+}
+
+const type_t* create_map_type(memory_pool_t* pool, const type_t* key, const type_t* elem) {
+    type_t* t = palloc(pool, sizeof(type_t));
+    if (!t) return NULL;
+    memset(t, 0, sizeof(*t));
+    t->kind = TYPE_MAP;
+    t->key = key;
+    t->elem = elem;
+    return t;
+}
+
+const type_t* create_array_type(memory_pool_t* pool, const type_t* elem) {
+    type_t* t = palloc(pool, sizeof(type_t));
+    if (!t) return NULL;
+    memset(t, 0, sizeof(*t));
+    t->kind = TYPE_ARRAY;
+    t->elem = elem;
+    return t;
+}
+
+// 解析 "map[string]array[int]" 形式的类型描述, 与 parser.y 中的 type_spec 对应
+static const type_t* parse_type_at(memory_pool_t* pool, const char** p) {
+    if (strncmp(*p, "string", 6) == 0) {
+        *p += 6;
+        return &type_string;
+    }
+    if (strncmp(*p, "int", 3) == 0) {
+        *p += 3;
+        return &type_int;
+    }
+    if (strncmp(*p, "float", 5) == 0) {
+        *p += 5;
+        return &type_float;
+    }
+    if (strncmp(*p, "map[", 4) == 0) {
+        *p += 4;
+        const type_t* key = parse_type_at(pool, p);
+        if (!key || **p != ']') return NULL;
+        (*p)++;
+        const type_t* elem = parse_type_at(pool, p);
+        if (!elem) return NULL;
+        return create_map_type(pool, key, elem);
+    }
+    if (strncmp(*p, "array[", 6) == 0) {
+        *p += 6;
+        const type_t* elem = parse_type_at(pool, p);
+        if (!elem || **p != ']') return NULL;
+        (*p)++;
+        return create_array_type(pool, elem);
+    }
+    return NULL;
+}
+
+const type_t* parse_type_spec(memory_pool_t* pool, const char* spec) {
+    if (!spec) return NULL;
+    const char* p = spec;
+    const type_t* t = parse_type_at(pool, &p);
+    return (t && *p == '\0') ? t : NULL;
+}
+
+int type_equal(const type_t* a, const type_t* b) {
+    if (a == b) return 1;
+    if (!a || !b || a->kind != b->kind) return 0;
+
+    switch (a->kind) {
+        case TYPE_MAP:
+            return type_equal(a->key, b->key) && type_equal(a->elem, b->elem);
+        case TYPE_ARRAY:
+            return type_equal(a->elem, b->elem);
+        case TYPE_STRUCT:
+            return a->name && b->name && strcmp(a->name, b->name) == 0;
+        default:
+            return 1;
+    }
+}
+
+int type_is_numeric(const type_t* t) {
+    return t && (t->kind == TYPE_INT || t->kind == TYPE_FLOAT);
+}
+
+// string / map / array 可以为 nil, 例如 map 中不存在的键
+int type_is_nullable(const type_t* t) {
+    return t && (t->kind == TYPE_STRING || t->kind == TYPE_MAP || t->kind == TYPE_ARRAY);
+}
+
+int struct_field_index(const type_t* t, const char* name) {
+    if (!t || t->kind != TYPE_STRUCT) return -1;
+    for (int i = 0; i < t->field_count; i++) {
+        if (strcmp(t->fields[i].name, name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+const char* type_to_string(const type_t* t, char* buf, size_t size) {
+    char key[64], elem[64];
+    if (!t) {
+        snprintf(buf, size, "?");
+        return buf;
+    }
+
+    switch (t->kind) {
+        case TYPE_NIL: snprintf(buf, size, "nil"); break;
+        case TYPE_INT: snprintf(buf, size, "int"); break;
+        case TYPE_FLOAT: snprintf(buf, size, "float"); break;
+        case TYPE_STRING: snprintf(buf, size, "string"); break;
+        case TYPE_MAP:
+            snprintf(buf, size, "map[%s]%s",
+                     type_to_string(t->key, key, sizeof(key)),
+                     type_to_string(t->elem, elem, sizeof(elem)));
+            break;
+        case TYPE_ARRAY:
+            snprintf(buf, size, "array[%s]", type_to_string(t->elem, elem, sizeof(elem)));
+            break;
+        case TYPE_STRUCT:
+            snprintf(buf, size, "%s", t->name ? t->name : "struct");
+            break;
+    }
+    return buf;
+}
@@ -0,0 +1,198 @@
+#include <string.h>
+#include "hash.h"
+#include "value.h"
+#include "types.h"
+
+// 类型的零值: int/float 为 0, 其他为 nil
+value_t value_zero(const type_t* t) {
+    if (t && t->kind == TYPE_INT) return value_int(0);
+    if (t && t->kind == TYPE_FLOAT) return value_float(0.0);
+    return value_nil();
+}
+
+// 短字符串存放在值内, 长字符串复制到请求 arena
+value_t value_string(memory_pool_t* arena, const char* ptr, size_t len) {
+    value_t v;
+    if (len <= VALUE_SMALL_MAX) {
+        v.small.tag = VALUE_SMALL_STR;
+        v.small.len = (uint8_t)len;
+        memcpy(v.small.data, ptr, len);
+        return v;
+    }
+
+    char* copy = palloc(arena, len);
+    if (!copy) return value_nil();
+    memcpy(copy, ptr, len);
+    return value_view(copy, len);
+}
+
+value_t value_concat(memory_pool_t* arena, const value_t* a, const value_t* b) {
+    size_t a_len = value_is_string(a) ? value_str_len(a) : 0;
+    size_t b_len = value_is_string(b) ? value_str_len(b) : 0;
+    size_t len = a_len + b_len;
+    value_t v;
+
+    if (len <= VALUE_SMALL_MAX) {
+        v.small.tag = VALUE_SMALL_STR;
+        v.small.len = (uint8_t)len;
+        if (a_len) memcpy(v.small.data, value_str_data(a), a_len);
+        if (b_len) memcpy(v.small.data + a_len, value_str_data(b), b_len);
+        return v;
+    }
+
+    char* buf = palloc(arena, len);
+    if (!buf) return value_nil();
+    if (a_len) memcpy(buf, value_str_data(a), a_len);
+    if (b_len) memcpy(buf + a_len, value_str_data(b), b_len);
+    return value_view(buf, len);
+}
+
+// 按字节比较两个字符串, 调用方保证两者都不是 nil
+int value_str_compare(const value_t* a, const value_t* b) {
+    size_t a_len = value_str_len(a);
+    size_t b_len = value_str_len(b);
+    int cmp = memcmp(value_str_data(a), value_str_data(b), a_len < b_len ? a_len : b_len);
+    if (cmp != 0) return cmp;
+    return a_len < b_len ? -1 : (a_len > b_len ? 1 : 0);
+}
+
+int value_str_equal(const value_t* a, const char* ptr, size_t len) {
+    return value_is_string(a) && value_str_len(a) == len &&
+           memcmp(value_str_data(a), ptr, len) == 0;
+}
+
+// map 键比较, 键只会是 string / int / float
+int value_key_equal(const value_t* a, const value_t* b) {
+    if (value_is_string(a)) {
+        return value_str_equal(b, value_str_data(a), value_str_len(a));
+    }
+    if (a->tag != b->tag) return 0;
+    switch (a->tag) {
+        case VALUE_INT: return a->i.value == b->i.value;
+        case VALUE_FLOAT: return a->f.value == b->f.value;
+        case VALUE_NIL: return 1;
+        default: return a->object.ptr == b->object.ptr;
+    }
+}
+
+value_map_t* create_value_map(memory_pool_t* arena, int capacity) {
+    value_map_t* map = palloc(arena, sizeof(value_map_t));
+    if (!map) return NULL;
+
+    map->count = 0;
+    map->capacity = capacity;
+    map->keys = palloc(arena, sizeof(value_t) * (capacity + 1));
+    map->values = palloc(arena, sizeof(value_t) * (capacity + 1));
+    if (!map->keys || !map->values) return NULL;
+    return map;
+}
+
+// 插入或覆盖, 容量不足时返回 -1
+int value_map_put(value_map_t* map, value_t key, value_t value) {
+    for (int i = 0; i < map->count; i++) {
+        if (value_key_equal(&map->keys[i], &key)) {
+            map->values[i] = value;
+            return 0;
+        }
+    }
+    if (map->count >= map->capacity) return -1;
+
+    map->keys[map->count] = key;
+    map->values[map->count] = value;
+    map->count++;
+    return 0;
+}
+
+// 请求中的 map 通常只有几十项, 顺序查找足够
+const value_t* value_map_get(const value_map_t* map, const value_t* key) {
+    for (int i = 0; i < map->count; i++) {
+        if (value_key_equal(&map->keys[i], key)) {
+            return &map->values[i];
+        }
+    }
+    return NULL;
+}
+
+const value_t* value_map_find(const value_map_t* map, const char* key, size_t len) {
+    for (int i = 0; i < map->count; i++) {
+        if (value_str_equal(&map->keys[i], key, len)) {
+            return &map->values[i];
+        }
+    }
+    return NULL;
+}
+
+value_array_t* create_value_array(memory_pool_t* arena, int count) {
+    value_array_t* array = palloc(arena, sizeof(value_array_t));
+    if (!array) return NULL;
+
+    array->count = count;
+    array->items = palloc(arena, sizeof(value_t) * (count + 1));
+    if (!array->items) return NULL;
+    return array;
+}
+
+// FNV-1a, 字符串按内容哈希, 短字符串与视图的哈希值一致
+uint32_t value_hash(const value_t* v) {
+    const void* p;
+    size_t len;
+    double d;
+
+    if (value_is_string(v)) {
+        p = value_str_data(v);
+        len = value_str_len(v);
+    } else if (v->tag == VALUE_FLOAT) {
+        d = v->f.value == 0.0 ? 0.0 : v->f.value;  // -0.0 与 0.0 相等
+        p = &d;
+        len = sizeof(d);
+    } else {
+        p = &v->i.value;
+        len = sizeof(v->i.value);
+    }
+    return fnv1a_32(FNV32_OFFSET, p, len);
+}
+
+value_set_t* create_value_set(memory_pool_t* pool, const value_t* items, int count) {
+    value_set_t* set = palloc(pool, sizeof(value_set_t));
+    if (!set) return NULL;
+
+    uint32_t size = 4;
+    while (size < (uint32_t)count * 2) size <<= 1;
+
+    set->count = 0;
+    set->mask = size - 1;
+    set->hashes = palloc(pool, sizeof(uint32_t) * size);
+    set->slots = palloc(pool, sizeof(value_t) * size);
+    if (!set->hashes || !set->slots) return NULL;
+    for (uint32_t i = 0; i < size; i++) {
+        set->slots[i] = value_nil();
+    }
+
+    for (int i = 0; i < count; i++) {
+        if (value_is_nil(&items[i]) || value_set_contains(set, &items[i])) continue;
+
+        uint32_t h = value_hash(&items[i]);
+        uint32_t pos = h & set->mask;
+        while (!value_is_nil(&set->slots[pos])) {
+            pos = (pos + 1) & set->mask;
+        }
+        set->hashes[pos] = h;
+        set->slots[pos] = items[i];
+        set->count++;
+    }
+    return set;
+}
+
+// 线性探测, 负载不超过一半, 期望探测次数为常数
+int value_set_contains(const value_set_t* set, const value_t* v) {
+    if (value_is_nil(v)) return 0;
+
+    uint32_t h = value_hash(v);
+    for (uint32_t pos = h & set->mask; !value_is_nil(&set->slots[pos]);
+         pos = (pos + 1) & set->mask) {
+        if (set->hashes[pos] == h && value_key_equal(&set->slots[pos], v)) {
+            return 1;
+        }
+    }
+    return 0;
+}